@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    Measures how long each processBlock call takes against its realtime
+    budget (numSamples / sampleRate).
+
+  ==============================================================================
+*/
+
+#include "DspLoadMeter.h"
+
+DspLoadMeter::DspLoadMeter()
+{
+    reset();
+}
+
+void DspLoadMeter::prepare(double sampleRate)
+{
+    nsPerSample.store(sampleRate > 0.0 ? 1.0e9 / sampleRate : 0.0, std::memory_order_relaxed);
+}
+
+void DspLoadMeter::reset()
+{
+    numBlocks.store(0, std::memory_order_relaxed);
+    numOverruns.store(0, std::memory_order_relaxed);
+    totalDurationNs.store(0, std::memory_order_relaxed);
+    totalBudgetNs.store(0, std::memory_order_relaxed);
+    maxDurationNs.store(0, std::memory_order_relaxed);
+    maxLoad.store(0.0, std::memory_order_relaxed);
+
+    for (auto& bucket : histogram)
+        bucket.store(0, std::memory_order_relaxed);
+}
+
+void DspLoadMeter::addBlock(int64_t durationNs, int numSamples) noexcept
+{
+    const double budgetNs = numSamples * nsPerSample.load(std::memory_order_relaxed);
+    const double load = budgetNs > 0.0 ? (double)durationNs / budgetNs : 0.0;
+
+    numBlocks.fetch_add(1, std::memory_order_relaxed);
+    totalDurationNs.fetch_add((uint64_t)durationNs, std::memory_order_relaxed);
+    totalBudgetNs.fetch_add((uint64_t)budgetNs, std::memory_order_relaxed);
+    histogram[(size_t)getBucketIndex(durationNs)].fetch_add(1, std::memory_order_relaxed);
+
+    if (load > 1.0)
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+
+    // Only the audio thread writes these, so a plain compare is enough; reset()
+    // racing with it can at worst leave one stale maximum behind.
+    if (durationNs > maxDurationNs.load(std::memory_order_relaxed))
+        maxDurationNs.store(durationNs, std::memory_order_relaxed);
+
+    if (load > maxLoad.load(std::memory_order_relaxed))
+        maxLoad.store(load, std::memory_order_relaxed);
+}
+
+DspLoadMeter::Statistics DspLoadMeter::getStatistics() const
+{
+    Statistics s;
+    s.numBlocks = numBlocks.load(std::memory_order_relaxed);
+    s.numOverruns = numOverruns.load(std::memory_order_relaxed);
+    s.maxLoad = maxLoad.load(std::memory_order_relaxed);
+    s.maxDurationMs = maxDurationNs.load(std::memory_order_relaxed) * 1.0e-6;
+
+    const auto budget = totalBudgetNs.load(std::memory_order_relaxed);
+    s.averageLoad = budget > 0 ? (double)totalDurationNs.load(std::memory_order_relaxed) / (double)budget : 0.0;
+
+    uint64_t histogramTotal = 0;
+
+    for (size_t i = 0; i < histogram.size(); ++i)
+    {
+        s.histogram[i] = histogram[i].load(std::memory_order_relaxed);
+        histogramTotal += s.histogram[i];
+    }
+
+    // Walk up the histogram until 99% of the blocks are accounted for
+    const uint64_t p99Count = histogramTotal - histogramTotal / 100;
+    uint64_t count = 0;
+
+    for (int i = 0; i < numBuckets && histogramTotal > 0; ++i)
+    {
+        count += s.histogram[(size_t)i];
+
+        if (count >= p99Count)
+        {
+            s.p99DurationMs = getBucketUpperBoundNs(i) * 1.0e-6;
+            break;
+        }
+    }
+
+    return s;
+}
+
+//==============================================================================
+// Buckets 0-3 hold 0-3 ns; above that each power of two is split into four,
+// so bucket 4 * (octave - 1) + quarter covers [(4 + quarter) << (octave - 2), ...)
+int DspLoadMeter::getBucketIndex(int64_t durationNs) noexcept
+{
+    if (durationNs < 4)
+        return durationNs < 0 ? 0 : (int)durationNs;
+
+    int octave = 0;
+
+    for (auto n = (uint64_t)durationNs; n > 1; n >>= 1)
+        ++octave;
+
+    const int quarter = (int)((uint64_t)durationNs >> (octave - 2)) & 3;
+    const int index = 4 * (octave - 1) + quarter;
+
+    return index < numBuckets ? index : numBuckets - 1;
+}
+
+int64_t DspLoadMeter::getBucketLowerBoundNs(int bucket) noexcept
+{
+    if (bucket < 4)
+        return bucket;
+
+    const int octave = bucket / 4 + 1;
+    const int quarter = bucket % 4;
+
+    return (int64_t)(4 + quarter) << (octave - 2);
+}
+
+int64_t DspLoadMeter::getBucketUpperBoundNs(int bucket) noexcept
+{
+    return getBucketLowerBoundNs(bucket + 1);
+}
@@ -0,0 +1,88 @@
+/*
+  ==============================================================================
+
+    Measures how long each processBlock call takes against its realtime
+    budget (numSamples / sampleRate).
+
+    The audio thread only does relaxed atomic increments, so the statistics
+    can be read from the message thread at any time without locking. Block
+    durations go into a histogram with four buckets per octave, from which
+    percentiles are estimated.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+class DspLoadMeter
+{
+public:
+    static constexpr int numBuckets = 128;
+
+    struct Statistics
+    {
+        uint64_t numBlocks = 0;
+        uint64_t numOverruns = 0;        // blocks that took longer than their realtime budget
+        double averageLoad = 0.0;        // total processing time / total budget
+        double maxLoad = 0.0;            // worst single block, as a fraction of its budget
+        double maxDurationMs = 0.0;
+        double p99DurationMs = 0.0;      // upper edge of the histogram bucket holding the 99th percentile
+        std::array<uint32_t, numBuckets> histogram {};
+    };
+
+    DspLoadMeter();
+
+    // Call before processing starts, whenever the sample rate changes
+    void prepare(double sampleRate);
+
+    // Clears all the statistics; safe to call while the audio thread is running
+    void reset();
+
+    // Records one block; called from the audio thread
+    void addBlock(int64_t durationNs, int numSamples) noexcept;
+
+    Statistics getStatistics() const;
+
+    // Range of block durations, in nanoseconds, that a histogram bucket covers
+    static int64_t getBucketLowerBoundNs(int bucket) noexcept;
+    static int64_t getBucketUpperBoundNs(int bucket) noexcept;
+
+    // Times the enclosing scope and adds it to the meter as one block
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(DspLoadMeter& meterToUse, int numSamplesInBlock) noexcept
+            : meter(meterToUse), numSamples(numSamplesInBlock), start(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~ScopedTimer()
+        {
+            const auto duration = std::chrono::steady_clock::now() - start;
+            meter.addBlock(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), numSamples);
+        }
+
+    private:
+        DspLoadMeter& meter;
+        const int numSamples;
+        const std::chrono::steady_clock::time_point start;
+    };
+
+private:
+    static int getBucketIndex(int64_t durationNs) noexcept;
+
+    std::atomic<double> nsPerSample { 1.0e9 / 44100.0 };
+
+    std::atomic<uint64_t> numBlocks { 0 };
+    std::atomic<uint64_t> numOverruns { 0 };
+    std::atomic<uint64_t> totalDurationNs { 0 };
+    std::atomic<uint64_t> totalBudgetNs { 0 };
+    std::atomic<int64_t> maxDurationNs { 0 };
+    std::atomic<double> maxLoad { 0.0 };
+    std::array<std::atomic<uint32_t>, numBuckets> histogram;
+};
@@ -0,0 +1,123 @@
+/*
+  ==============================================================================
+
+    Circular delay line whose interpolation windows never wrap.
+
+  ==============================================================================
+*/
+
+#include "FlangerDelayLine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::prepare(int maximumLength, int numChannels)
+{
+    capacity = kGuardSamples;
+
+    while (capacity < maximumLength)
+        capacity *= 2;
+
+    length = capacity;
+    mask = length - 1;
+
+    channelShift = 0;
+
+    while ((1 << channelShift) < numChannels)
+        ++channelShift;
+
+    data.assign((size_t)(capacity + kGuardSamples) << channelShift, SampleType());
+}
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::setLength(int minimumLength) noexcept
+{
+    if (capacity == 0)
+        return;
+
+    length = kGuardSamples;
+
+    while (length < minimumLength && length < capacity)
+        length *= 2;
+
+    mask = length - 1;
+}
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::clear() noexcept
+{
+    // The mirror of the first kGuardSamples frames sits just past the end of the ring
+    std::fill(data.begin(), data.begin() + ((size_t)(length + kGuardSamples) << channelShift), SampleType());
+}
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::clear(int position, int numFrames) noexcept
+{
+    if (numFrames <= 0)
+        return;
+
+    const int start = (position - numFrames) & mask;
+    const int beforeWrap = std::min(numFrames, length - start);
+
+    std::fill(data.begin() + (start << channelShift), data.begin() + ((start + beforeWrap) << channelShift), SampleType());
+    std::fill(data.begin(), data.begin() + ((numFrames - beforeWrap) << channelShift), SampleType());
+
+    // Cheaper to refresh the whole mirror than to work out which of it was cleared
+    std::copy(data.begin(), data.begin() + (kGuardSamples << channelShift), data.begin() + (length << channelShift));
+}
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::write(int position, const SampleType* frames, int numFrames) noexcept
+{
+    const int beforeWrap = std::min(numFrames, length - position);
+
+    std::copy(frames, frames + (beforeWrap << channelShift), data.begin() + (position << channelShift));
+    std::copy(frames + (beforeWrap << channelShift), frames + (numFrames << channelShift), data.begin());
+
+    // Refresh the mirror if any of the frames landed in the guarded region
+    const int guardStart = numFrames > beforeWrap ? 0 : position;
+    const int guardEnd = numFrames > beforeWrap ? std::min(numFrames - beforeWrap, (int)kGuardSamples)
+                                                : std::min(position + numFrames, (int)kGuardSamples);
+
+    if (guardStart < guardEnd)
+        std::copy(data.begin() + (guardStart << channelShift), data.begin() + (guardEnd << channelShift),
+                  data.begin() + ((length + guardStart) << channelShift));
+}
+
+template <typename SampleType>
+SampleType FlangerDelayLine<SampleType>::getPeak(int position, int numFrames) const noexcept
+{
+    // The frames run up to position, so they wrap if they start before the beginning
+    const int start = (position - numFrames) & mask;
+    const int beforeWrap = std::min(numFrames, length - start);
+
+    SampleType peak = SampleType();
+
+    const auto scan = [&](int first, int count)
+    {
+        for (int i = first << channelShift; i < (first + count) << channelShift; ++i)
+            peak = std::max(peak, std::abs(data[(size_t)i]));
+    };
+
+    scan(start, beforeWrap);
+    scan(0, numFrames - beforeWrap);
+
+    return peak;
+}
+
+template <typename SampleType>
+void FlangerDelayLine<SampleType>::read(int position, SampleType* frames, int numFrames) const noexcept
+{
+    if (numFrames <= 0)
+        return;
+
+    const int beforeWrap = std::min(numFrames, length - position);
+
+    std::copy(data.begin() + (position << channelShift), data.begin() + ((position + beforeWrap) << channelShift), frames);
+    std::copy(data.begin(), data.begin() + ((numFrames - beforeWrap) << channelShift), frames + (beforeWrap << channelShift));
+}
+
+template class FlangerDelayLine<float>;
+template class FlangerDelayLine<double>;
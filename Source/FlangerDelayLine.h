@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    Circular delay line whose interpolation windows never wrap.
+
+    The ring is a power of two long, so positions wrap with a mask, and the
+    first kGuardSamples samples are mirrored just past its end. Any window of
+    up to kGuardSamples + 1 consecutive taps is then contiguous in memory
+    wherever it starts, so an interpolator reads it through a plain pointer
+    (or a single unaligned vector load) without wrapping each tap.
+
+    A line can also hold several channels, interleaved frame by frame, so
+    every channel's sample for a given position sits side by side in memory
+    and the channels can be processed in the lanes of one vector. Positions
+    and lengths are then counted in frames.
+
+    Lines come in float and double, for the two precisions a host can
+    process in.
+
+    prepare() allocates room for the longest ring the line will ever need,
+    and setLength() picks how much of it the ring actually uses, without
+    allocating. The write pointer sweeps the whole ring, so keeping it no
+    longer than the current settings need keeps the working set small.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+template <typename SampleType>
+class FlangerDelayLine
+{
+public:
+    static constexpr int kGuardSamples = 16;
+
+    // Allocates at least maximumLength (and at least kGuardSamples) frames, rounded up
+    // to a power of two, of numChannels interleaved samples each, and clears them. The
+    // ring starts out using all of them. numChannels must be a power of two.
+    void prepare(int maximumLength, int numChannels = 1);
+
+    // Makes the ring at least minimumLength frames long, rounded up to a power of two but
+    // no longer than prepare() allocated. Never allocates. Doesn't clear either: the
+    // frames the ring covers keep whatever they held, so silence the ones a read can
+    // reach with clear(position, numFrames).
+    void setLength(int minimumLength) noexcept;
+
+    // Clears the frames the ring uses
+    void clear() noexcept;
+
+    // Clears just the numFrames frames before position, e.g. the ones written since the
+    // last clear, so resetting costs what was used rather than the whole ring. numFrames
+    // is at most getLength().
+    void clear(int position, int numFrames) noexcept;
+
+    int getLength() const noexcept { return length; }
+    int getCapacity() const noexcept { return capacity; }
+    int getMask() const noexcept { return mask; }
+    int getNumChannels() const noexcept { return 1 << channelShift; }
+
+    // Single-channel lines only; position is in [0, getLength())
+    void write(int position, SampleType sample) noexcept
+    {
+        data[(size_t)position] = sample;
+
+        if (position < kGuardSamples)
+            data[(size_t)(position + length)] = sample;
+    }
+
+    // Writes one sample per channel at position
+    void writeFrame(int position, const SampleType* frame) noexcept
+    {
+        const int numChannels = getNumChannels();
+        SampleType* destination = data.data() + ((size_t)position << channelShift);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            destination[channel] = frame[channel];
+
+        if (position < kGuardSamples)
+        {
+            SampleType* guard = destination + ((size_t)length << channelShift);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                guard[channel] = frame[channel];
+        }
+    }
+
+    // Writes numFrames consecutive interleaved frames from position on, wrapping past
+    // the end. numFrames is at most getLength().
+    void write(int position, const SampleType* frames, int numFrames) noexcept;
+
+    // The other way round: copies numFrames frames from position on out into frames
+    void read(int position, SampleType* frames, int numFrames) const noexcept;
+
+    // The window of taps starting tapsBefore frames before index, e.g. tapsBefore = 1
+    // for a cubic interpolator's window[0..3] = samples index - 1 ... index + 2. In a
+    // multichannel line, tap n of channel c is at window[n * getNumChannels() + c].
+    // Valid for windows of up to kGuardSamples + 1 taps.
+    const SampleType* getWindow(int index, int tapsBefore) const noexcept
+    {
+        return data.data() + (((index - tapsBefore) & mask) << channelShift);
+    }
+
+    // The largest magnitude in any channel of the numFrames frames before position, e.g.
+    // to tell whether anything a read could still reach is audible. numFrames is at most
+    // getLength().
+    SampleType getPeak(int position, int numFrames) const noexcept;
+
+private:
+    std::vector<SampleType> data;
+    int capacity = 0;
+    int length = 0;
+    int mask = -1;
+    int channelShift = 0;
+};
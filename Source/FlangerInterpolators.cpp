@@ -0,0 +1,106 @@
+/*
+  ==============================================================================
+
+    Coefficient tables and costs of the fractional delay interpolators.
+
+  ==============================================================================
+*/
+
+#include "FlangerInterpolators.h"
+
+#include <cmath>
+
+namespace FlangerKernel
+{
+    namespace
+    {
+        constexpr double pi = 3.141592653589793238;
+        constexpr double kSincKaiserBeta = 6.0;
+
+        // Zeroth-order modified Bessel function of the first kind, for the Kaiser window
+        double besselI0(double x)
+        {
+            double term = 1.0, sum = 1.0;
+
+            for (int k = 1; term > 1.0e-12 * sum; ++k)
+            {
+                const double half = x / (2.0 * k);
+                term *= half * half;
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        detail::SincTable makeSincTable()
+        {
+            detail::SincTable table;
+            const double halfWidth = 0.5 * detail::kSincTaps;
+
+            for (int phase = 0; phase <= kPhases; ++phase)
+            {
+                float* row = table.coefficients + phase * detail::kSincTaps;
+                double taps[detail::kSincTaps];
+                double sum = 0.0;
+
+                for (int tap = 0; tap < detail::kSincTaps; ++tap)
+                {
+                    // Distance of the tap from the read point, in samples
+                    const double t = tap - SincInterpolator::kTapsBefore - (double)phase / kPhases;
+                    const double edge = t / halfWidth;
+                    const double window = besselI0(kSincKaiserBeta * std::sqrt(edge < 1.0 ? 1.0 - edge * edge : 0.0))
+                                          / besselI0(kSincKaiserBeta);
+
+                    // The read point lands exactly on this tap (sinc(0) = 1)
+                    const bool onTap = (tap - SincInterpolator::kTapsBefore) * kPhases == phase;
+
+                    taps[tap] = (onTap ? 1.0 : std::sin(pi * t) / (pi * t)) * window;
+                    sum += taps[tap];
+                }
+
+                for (int tap = 0; tap < detail::kSincTaps; ++tap)
+                    row[tap] = (float)(taps[tap] / sum);
+            }
+
+            return table;
+        }
+
+        detail::ThiranTable makeThiranTable()
+        {
+            detail::ThiranTable table;
+
+            for (int phase = 0; phase <= kPhases; ++phase)
+            {
+                // The delay from the newer of the two taps filtered, between 0.5 and 1.5
+                const double fraction = (double)phase / kPhases;
+                const double delay = phase < kPhases / 2 ? 1.0 - fraction : 2.0 - fraction;
+
+                table.coefficients[phase] = (float)((1.0 - delay) / (1.0 + delay));
+            }
+
+            return table;
+        }
+
+        const InterpolatorCost costs[kNumInterpolations] =
+        {
+            { "linear",    2,  4, 0,                                   false },
+            { "quadratic", 3,  9, 0,                                   false },
+            { "cubic",     4, 24, 0,                                   false },
+            { "lagrange3", 4, 20, 0,                                   false },
+            { "lagrange5", 6, 51, 0,                                   false },
+            { "sinc8",     8, 17, (int)sizeof(detail::SincTable),    false },
+            { "thiran",    2,  5, (int)sizeof(detail::ThiranTable),  true }
+        };
+    }
+
+    namespace detail
+    {
+        const SincTable sincTable = makeSincTable();
+        const ThiranTable thiranTable = makeThiranTable();
+    }
+
+    const InterpolatorCost& getInterpolatorCost(int interpolation) noexcept
+    {
+        return costs[interpolation >= 0 && interpolation < kNumInterpolations ? interpolation : kLinear];
+    }
+}
@@ -0,0 +1,348 @@
+/*
+  ==============================================================================
+
+    Fractional delay interpolators for the flanger kernels.
+
+    Each interpolator reads a window of kNumTaps consecutive delay line
+    samples that starts kTapsBefore samples before the read index, and
+    interpolates fraction of the way from the index towards the sample after
+    it. FlangerDelayLine keeps every such window contiguous, so no tap needs
+    wrapping.
+
+    Besides the original linear, quadratic and Catmull-Rom cubic modes there
+    are Lagrange polynomials through 4 and 6 taps, an 8-tap windowed sinc and
+    a first-order Thiran allpass. None of them works out coefficients from the
+    fraction per sample: the Lagrange ones are in Farrow form (fixed sums of
+    the taps, then Horner's rule in the fraction) and the sinc and allpass
+    look theirs up in tables indexed by the fraction rounded to 1/kPhases of
+    a sample. getInterpolatorCost() reports what each one costs.
+
+    Every interpolator reads float or double taps and returns the same type;
+    the fraction and the coefficient tables are float for both.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define FLANGER_KERNEL_SSE 1
+ #include <emmintrin.h>
+#else
+ #define FLANGER_KERNEL_SSE 0
+#endif
+
+namespace FlangerKernel
+{
+    enum Interpolation
+    {
+        kLinear = 0,
+        kQuadratic,
+        kCubic,
+        kLagrange3,
+        kLagrange5,
+        kSinc,
+        kThiran,
+        kNumInterpolations
+    };
+
+    // What one interpolated sample of one channel costs
+    struct InterpolatorCost
+    {
+        const char* name;
+        int numTaps;        // delay line samples read
+        int flops;          // float multiplies and adds
+        int tableBytes;     // coefficient table read from, 0 for none
+        bool recursive;     // keeps state from sample to sample, so runs one sample at a time
+    };
+
+    // Unknown modes report linear's cost, as getKernel() falls back to linear
+    const InterpolatorCost& getInterpolatorCost(int interpolation) noexcept;
+
+    constexpr int kMaxTaps = 8;     // the widest window any interpolator reads
+    constexpr int kPhases = 512;    // table-driven interpolators round the fraction to 1/kPhases
+
+    //==============================================================================
+    namespace detail
+    {
+        constexpr int kSincTaps = 8;
+
+        // Row p holds the sinc taps for a fraction of p / kPhases; there's a row for a
+        // fraction of 1 so rounding never needs clamping. A row is 32 bytes, and the whole
+        // table fits in L1.
+        struct alignas(64) SincTable
+        {
+            float coefficients[(kPhases + 1) * kSincTaps];
+        };
+
+        // The allpass coefficient for each rounded fraction
+        struct ThiranTable
+        {
+            float coefficients[kPhases + 1];
+        };
+
+        // Filled in during static initialisation, never on the audio thread
+        extern const SincTable sincTable;
+        extern const ThiranTable thiranTable;
+
+        inline int getPhase(float fraction) noexcept
+        {
+            return (int)(fraction * (float)kPhases + 0.5f);
+        }
+
+       #if FLANGER_KERNEL_SSE
+        // Four lanes of floats with arithmetic operators, so an interpolator written once as
+        // a template evaluates exactly the same expression on a float and on four lanes
+        struct Lanes
+        {
+            Lanes() = default;
+            Lanes(__m128 value) noexcept : v(value) {}
+            Lanes(float value) noexcept : v(_mm_set1_ps(value)) {}
+
+            __m128 v;
+        };
+
+        inline Lanes operator+(Lanes a, Lanes b) noexcept { return _mm_add_ps(a.v, b.v); }
+        inline Lanes operator-(Lanes a, Lanes b) noexcept { return _mm_sub_ps(a.v, b.v); }
+        inline Lanes operator*(Lanes a, Lanes b) noexcept { return _mm_mul_ps(a.v, b.v); }
+
+        template <typename Interpolator>
+        __m128 evaluateLanes(const __m128* taps, __m128 fraction) noexcept
+        {
+            Lanes lanes[Interpolator::kNumTaps];
+
+            for (int tap = 0; tap < Interpolator::kNumTaps; ++tap)
+                lanes[tap] = taps[tap];
+
+            return Interpolator::evaluate(lanes, Lanes(fraction)).v;
+        }
+       #endif
+    }
+
+    //==============================================================================
+    // Stateless interpolators are function objects rather than functions so every kernel
+    // gets its own inlined copy. With SSE, interpolate() does the same for four float
+    // samples at once, given their windows transposed so that taps[n] holds tap n of every
+    // sample.
+
+    struct LinearInterpolator
+    {
+        static constexpr int kTapsBefore = 0;
+        static constexpr int kNumTaps = 2;
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const
+        {
+            const SampleType x = fraction;
+
+            return x * window[1] + ((SampleType)1 - x) * window[0];
+        }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction)
+        {
+            return _mm_add_ps(_mm_mul_ps(fraction, taps[1]),
+                              _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), fraction), taps[0]));
+        }
+       #endif
+    };
+
+    // The parabola through the three samples around the read index (2nd order Lagrange)
+    struct QuadraticInterpolator
+    {
+        static constexpr int kTapsBefore = 1;
+        static constexpr int kNumTaps = 3;
+
+        template <typename T>
+        static T evaluate(const T* y, T x) noexcept
+        {
+            const T c1 = 0.5f * (y[2] - y[0]);
+            const T c2 = 0.5f * (y[0] + y[2]) - y[1];
+
+            return y[1] + x * (c1 + x * c2);
+        }
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const { return evaluate(window, (SampleType)fraction); }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction) { return detail::evaluateLanes<QuadraticInterpolator>(taps, fraction); }
+       #endif
+    };
+
+    // Cubic interpolation will produce cleaner results at the expense
+    // of more computation. This code uses the Catmull-Rom variant of
+    // cubic interpolation. To reduce the load, calculate a few quantities
+    // in advance that will be used several times in the equation.
+    struct CubicInterpolator
+    {
+        static constexpr int kTapsBefore = 1;
+        static constexpr int kNumTaps = 4;
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const
+        {
+            const SampleType x = fraction;
+            const SampleType frsq = x * x;
+
+            const SampleType a0 = -0.5f * window[0] + 1.5f * window[1]
+                - 1.5f * window[2] + 0.5f * window[3];
+            const SampleType a1 = window[0] - 2.5f * window[1]
+                + 2.0f * window[2] - 0.5f * window[3];
+            const SampleType a2 = -0.5f * window[0] + 0.5f * window[2];
+            const SampleType a3 = window[1];
+
+            return a0 * x * frsq + a1 * frsq + a2 * x + a3;
+        }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction)
+        {
+            auto times = [](float constant, __m128 tap) { return _mm_mul_ps(_mm_set1_ps(constant), tap); };
+
+            const __m128 frsq = _mm_mul_ps(fraction, fraction);
+
+            const __m128 a0 = _mm_add_ps(_mm_sub_ps(_mm_add_ps(times(-0.5f, taps[0]), times(1.5f, taps[1])),
+                                                    times(1.5f, taps[2])), times(0.5f, taps[3]));
+            const __m128 a1 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(taps[0], times(2.5f, taps[1])),
+                                                    times(2.0f, taps[2])), times(0.5f, taps[3]));
+            const __m128 a2 = _mm_add_ps(times(-0.5f, taps[0]), times(0.5f, taps[2]));
+            const __m128 a3 = taps[1];
+
+            return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(a0, fraction), frsq),
+                                                    _mm_mul_ps(a1, frsq)),
+                                         _mm_mul_ps(a2, fraction)), a3);
+        }
+       #endif
+    };
+
+    // The cubic through the four samples around the read index, as a polynomial in the
+    // fraction whose coefficients are fixed combinations of the taps (Farrow form)
+    struct Lagrange3Interpolator
+    {
+        static constexpr int kTapsBefore = 1;
+        static constexpr int kNumTaps = 4;
+
+        template <typename T>
+        static T evaluate(const T* y, T x) noexcept
+        {
+            const T c1 = y[2] - (1.0f / 3.0f) * y[0] - 0.5f * y[1] - (1.0f / 6.0f) * y[3];
+            const T c2 = 0.5f * (y[0] + y[2]) - y[1];
+            const T c3 = (1.0f / 6.0f) * (y[3] - y[0]) + 0.5f * (y[1] - y[2]);
+
+            return y[1] + x * (c1 + x * (c2 + x * c3));
+        }
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const { return evaluate(window, (SampleType)fraction); }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction) { return detail::evaluateLanes<Lagrange3Interpolator>(taps, fraction); }
+       #endif
+    };
+
+    // The quintic through the six samples around the read index, in Farrow form
+    struct Lagrange5Interpolator
+    {
+        static constexpr int kTapsBefore = 2;
+        static constexpr int kNumTaps = 6;
+
+        template <typename T>
+        static T evaluate(const T* y, T x) noexcept
+        {
+            const T c1 = y[3] + (1.0f / 20.0f) * y[0] - 0.5f * y[1] - (1.0f / 3.0f) * y[2]
+                       - 0.25f * y[4] + (1.0f / 30.0f) * y[5];
+            const T c2 = (2.0f / 3.0f) * (y[1] + y[3]) - (1.0f / 24.0f) * (y[0] + y[4]) - 1.25f * y[2];
+            const T c3 = (5.0f / 12.0f) * y[2] - (7.0f / 12.0f) * y[3] + (7.0f / 24.0f) * y[4]
+                       - (1.0f / 24.0f) * (y[0] + y[1] + y[5]);
+            const T c4 = (1.0f / 24.0f) * (y[0] + y[4]) - (1.0f / 6.0f) * (y[1] + y[3]) + 0.25f * y[2];
+            const T c5 = (1.0f / 120.0f) * (y[5] - y[0]) + (1.0f / 24.0f) * (y[1] - y[4]) + (1.0f / 12.0f) * (y[3] - y[2]);
+
+            return y[2] + x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5))));
+        }
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const { return evaluate(window, (SampleType)fraction); }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction) { return detail::evaluateLanes<Lagrange5Interpolator>(taps, fraction); }
+       #endif
+    };
+
+    // Kaiser-windowed sinc over eight taps, from a polyphase table. Each row is normalised
+    // to unity gain at DC, and no row's gain exceeds 1 by more than 0.2% anywhere, so
+    // feedback just below 1 stays stable.
+    struct SincInterpolator
+    {
+        static constexpr int kTapsBefore = 3;
+        static constexpr int kNumTaps = detail::kSincTaps;
+
+        static const float* getCoefficients(int phase) noexcept
+        {
+            return detail::sincTable.coefficients + phase * kNumTaps;
+        }
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, float fraction) const
+        {
+            const float* coefficients = getCoefficients(detail::getPhase(fraction));
+            SampleType sum = window[0] * coefficients[0];
+
+            for (int tap = 1; tap < kNumTaps; ++tap)
+                sum = sum + window[tap] * coefficients[tap];
+
+            return sum;
+        }
+
+       #if FLANGER_KERNEL_SSE
+        static __m128 interpolate(const __m128* taps, __m128 fraction)
+        {
+            alignas(16) int32_t phases[4];
+            _mm_store_si128((__m128i*)phases, _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(fraction, _mm_set1_ps((float)kPhases)),
+                                                                           _mm_set1_ps(0.5f))));
+
+            // Each lane's row, transposed like the taps so coefficients[n] multiplies taps[n]
+            __m128 coefficients[kNumTaps];
+
+            for (int tap = 0; tap < kNumTaps; tap += 4)
+            {
+                for (int lane = 0; lane < 4; ++lane)
+                    coefficients[tap + lane] = _mm_load_ps(getCoefficients(phases[lane]) + tap);
+
+                _MM_TRANSPOSE4_PS(coefficients[tap], coefficients[tap + 1], coefficients[tap + 2], coefficients[tap + 3]);
+            }
+
+            __m128 sum = _mm_mul_ps(taps[0], coefficients[0]);
+
+            for (int tap = 1; tap < kNumTaps; ++tap)
+                sum = _mm_add_ps(sum, _mm_mul_ps(taps[tap], coefficients[tap]));
+
+            return sum;
+        }
+       #endif
+    };
+
+    // First-order Thiran allpass: flat magnitude at every frequency, at the price of being
+    // recursive. It's most accurate for delays between 0.5 and 1.5 samples, so it filters
+    // the pair of taps that puts the read point in that range: index and index + 1 for
+    // fractions below a half, index + 1 and index + 2 above. Taps are stride samples apart
+    // and previous is the channel's last output, which this updates.
+    struct ThiranInterpolator
+    {
+        static constexpr int kTapsBefore = 0;
+        static constexpr int kNumTaps = 3;
+
+        template <typename SampleType>
+        SampleType operator()(const SampleType* window, int stride, float fraction, SampleType& previous) const
+        {
+            const int phase = detail::getPhase(fraction);
+            const SampleType* older = phase < kPhases / 2 ? window : window + stride;
+            const float coefficient = detail::thiranTable.coefficients[phase];
+
+            previous = coefficient * (older[stride] - previous) + older[0];
+            return previous;
+        }
+    };
+}
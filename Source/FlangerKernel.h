@@ -0,0 +1,698 @@
+/*
+  ==============================================================================
+
+    Per-channel flanger kernels: gather, interpolate, feed back and mix.
+
+    Each kernel takes the read positions computed by FlangerModulation and
+    runs one channel's delay line over a block. processScalar is the plain
+    per-sample loop. processVectorised works on kVectorBlock samples at a
+    time: feedback makes the loop look serial, but the taps always sit at
+    least the minimum delay behind the write pointer, so while a sub-block is
+    shorter than that, none of its reads can see any of its own writes. All
+    of a sub-block's samples can then be gathered and interpolated side by
+    side before any of them is written back.
+
+    Both kernels evaluate exactly the same float expressions, so they produce
+    identical output. While the feedback or depth gain is being smoothed, the
+    Ramped instantiations read a gain per sample from the Mix's ramps; the
+    others keep the gains in registers for the whole block.
+
+    The interpolators the kernels are instantiated with are in
+    FlangerInterpolators.h.
+
+    Every kernel also comes in double, for hosts processing in double
+    precision: the same code with double audio and delay lines, which runs
+    the portable sub-block loops where float has hand-written SSE. Gains and
+    read positions stay float in both.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FlangerDelayLine.h"
+#include "FlangerInterpolators.h"
+#include "FlangerModulation.h"
+
+#include <type_traits>
+
+namespace FlangerKernel
+{
+    constexpr int kVectorBlock = 16;
+
+    namespace detail
+    {
+        // Selects the hand-written SSE sub-block code, which only exists for float
+        template <typename SampleType>
+        using UseSse = std::integral_constant<bool, FLANGER_KERNEL_SSE != 0 && std::is_same<SampleType, float>::value>;
+    }
+
+    //==============================================================================
+    struct Mix
+    {
+        float feedback = 0.0f;  // gain of the delayed signal written back into the delay line
+        float depth = 0.0f;     // gain of the delayed signal added to the output
+
+        // While either gain is being smoothed, both gains for every sample of the block;
+        // only the Ramped kernels read them, and they ignore the constants above
+        const float* feedbackRamp = nullptr;
+        const float* depthRamp = nullptr;
+    };
+
+    // Sample i's gain: a constant, or read from the ramp in kernels specialised for one
+    template <bool Ramped>
+    float getGain(float constant, const float* ramp, int i) noexcept
+    {
+        return Ramped ? ramp[i] : constant;
+    }
+
+   #if FLANGER_KERNEL_SSE
+    // Samples i to i + 3's gains
+    template <bool Ramped>
+    __m128 getGains(__m128 constant, const float* ramp, int i) noexcept
+    {
+        return Ramped ? _mm_loadu_ps(ramp + i) : constant;
+    }
+   #endif
+
+    // What gets written back into the delay line. Kernels for a zero feedback gain are
+    // instantiated separately and just store the input.
+    template <bool Feedback, typename SampleType>
+    SampleType getFeedbackSample(SampleType in, SampleType interpolatedSample, float feedback) noexcept
+    {
+        return Feedback ? in + (interpolatedSample * feedback) : in;
+    }
+
+   #if FLANGER_KERNEL_SSE
+    template <bool Feedback>
+    __m128 getFeedbackSample(__m128 in, __m128 interpolated, __m128 feedback) noexcept
+    {
+        return Feedback ? _mm_add_ps(in, _mm_mul_ps(interpolated, feedback)) : in;
+    }
+   #endif
+
+    // Runs samples [begin, end) of the block one at a time; returns the write position after them
+    template <typename Interpolator, bool Feedback, bool Ramped, typename SampleType>
+    int processScalar(SampleType* channelData, int begin, int end, FlangerDelayLine<SampleType>& delayLine,
+                      const FlangerModulation::Trajectory& trajectory, int writePosition, Mix mix) noexcept
+    {
+        static_assert(Interpolator::kNumTaps <= FlangerDelayLine<SampleType>::kGuardSamples + 1, "window too wide");
+
+        const Interpolator interpolate;
+        const int mask = delayLine.getMask();
+
+        for (int i = begin; i < end; ++i)
+        {
+            const SampleType in = channelData[i];
+            const SampleType interpolatedSample = interpolate(delayLine.getWindow(trajectory.index[i], Interpolator::kTapsBefore),
+                                                         trajectory.fraction[i]);
+
+            delayLine.write(writePosition, getFeedbackSample<Feedback>(in, interpolatedSample,
+                                                                       getGain<Ramped>(mix.feedback, mix.feedbackRamp, i)));
+            writePosition = (writePosition + 1) & mask;
+
+            channelData[i] = in + getGain<Ramped>(mix.depth, mix.depthRamp, i) * interpolatedSample;
+        }
+
+        return writePosition;
+    }
+
+    // True if a kVectorBlock sub-block can't read anything it writes, given the shortest
+    // delay (in whole samples) any sample in the block can have. The last sample of a
+    // sub-block reads up to tapsAfter samples past a point delay samples behind itself,
+    // which has to stay before the sub-block's first write. One sample of slack covers
+    // the caller's estimate rounding differently from FlangerModulation.
+    template <typename Interpolator>
+    constexpr bool canVectorise(int minimumDelaySamples) noexcept
+    {
+        return minimumDelaySamples >= kVectorBlock + (Interpolator::kNumTaps - 1 - Interpolator::kTapsBefore) + 1;
+    }
+
+    // Runs the kVectorBlock samples from start on: the output goes back into channelData
+    // and the samples to feed back into feedbackSamples. Portable code, for any sample type.
+    template <typename Interpolator, bool Feedback, bool Ramped, typename SampleType>
+    void processSubBlock(SampleType* channelData, int start, const FlangerDelayLine<SampleType>& delayLine,
+                         const FlangerModulation::Trajectory& trajectory, Mix mix, SampleType* feedbackSamples,
+                         std::false_type) noexcept
+    {
+        SampleType* data = channelData + start;
+        const int* index = trajectory.index + start;
+        const float* fraction = trajectory.fraction + start;
+        const Interpolator interpolate;
+        SampleType interpolated[kVectorBlock];
+
+        for (int i = 0; i < kVectorBlock; ++i)
+            interpolated[i] = interpolate(delayLine.getWindow(index[i], Interpolator::kTapsBefore), fraction[i]);
+
+        for (int i = 0; i < kVectorBlock; ++i)
+            feedbackSamples[i] = getFeedbackSample<Feedback>(data[i], interpolated[i],
+                                                             getGain<Ramped>(mix.feedback, mix.feedbackRamp, start + i));
+
+        for (int i = 0; i < kVectorBlock; ++i)
+            data[i] = data[i] + getGain<Ramped>(mix.depth, mix.depthRamp, start + i) * interpolated[i];
+    }
+
+   #if FLANGER_KERNEL_SSE
+    // The same for float, four samples per vector
+    template <typename Interpolator, bool Feedback, bool Ramped>
+    void processSubBlock(float* channelData, int start, const FlangerDelayLine<float>& delayLine,
+                         const FlangerModulation::Trajectory& trajectory, Mix mix, float* feedbackSamples,
+                         std::true_type) noexcept
+    {
+        float* data = channelData + start;
+        const int* index = trajectory.index + start;
+        const float* fraction = trajectory.fraction + start;
+        const __m128 feedback = _mm_set1_ps(mix.feedback);
+        const __m128 depth = _mm_set1_ps(mix.depth);
+
+        for (int i = 0; i < kVectorBlock; i += 4)
+        {
+            // One unaligned load per window and group of four taps, then a transpose so
+            // taps[n] holds tap n of all four samples
+            __m128 taps[kMaxTaps];
+
+            for (int group = 0; group < Interpolator::kNumTaps; group += 4)
+            {
+                for (int sample = 0; sample < 4; ++sample)
+                    taps[group + sample] = _mm_loadu_ps(delayLine.getWindow(index[i + sample], Interpolator::kTapsBefore) + group);
+
+                _MM_TRANSPOSE4_PS(taps[group], taps[group + 1], taps[group + 2], taps[group + 3]);
+            }
+
+            const __m128 interpolated = Interpolator::interpolate(taps, _mm_loadu_ps(fraction + i));
+            const __m128 in = _mm_loadu_ps(data + i);
+
+            _mm_storeu_ps(feedbackSamples + i, getFeedbackSample<Feedback>(in, interpolated,
+                                                                           getGains<Ramped>(feedback, mix.feedbackRamp, start + i)));
+            _mm_storeu_ps(data + i, _mm_add_ps(in, _mm_mul_ps(getGains<Ramped>(depth, mix.depthRamp, start + i), interpolated)));
+        }
+    }
+   #endif
+
+    // Runs numSamples samples, in kVectorBlock sub-blocks where possible. Only call this
+    // when canVectorise() holds for the block. Returns the write position after the block.
+    template <typename Interpolator, bool Feedback, bool Ramped, typename SampleType>
+    int processVectorised(SampleType* channelData, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                          const FlangerModulation::Trajectory& trajectory, int writePosition, Mix mix) noexcept
+    {
+        static_assert(Interpolator::kNumTaps <= FlangerDelayLine<SampleType>::kGuardSamples + 1, "window too wide");
+        static_assert(kVectorBlock % 4 == 0, "sub-blocks are made of groups of four");
+
+        const int mask = delayLine.getMask();
+        const int vectorEnd = numSamples - numSamples % kVectorBlock;
+
+        for (int start = 0; start < vectorEnd; start += kVectorBlock)
+        {
+            SampleType feedbackSamples[kVectorBlock];
+
+            processSubBlock<Interpolator, Feedback, Ramped>(channelData, start, delayLine, trajectory, mix, feedbackSamples,
+                                                            detail::UseSse<SampleType>());
+
+            delayLine.write(writePosition, feedbackSamples, kVectorBlock);
+            writePosition = (writePosition + kVectorBlock) & mask;
+        }
+
+        return processScalar<Interpolator, Feedback, Ramped>(channelData, vectorEnd, numSamples, delayLine, trajectory, writePosition, mix);
+    }
+
+    // Picks the vectorised kernel whenever the minimum delay allows it
+    template <typename Interpolator, bool Feedback, bool Ramped, typename SampleType>
+    int process(SampleType* channelData, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                const FlangerModulation::Trajectory& trajectory, int writePosition, Mix mix,
+                int minimumDelaySamples) noexcept
+    {
+        if (canVectorise<Interpolator>(minimumDelaySamples))
+            return processVectorised<Interpolator, Feedback, Ramped>(channelData, numSamples, delayLine, trajectory, writePosition, mix);
+
+        return processScalar<Interpolator, Feedback, Ramped>(channelData, 0, numSamples, delayLine, trajectory, writePosition, mix);
+    }
+
+    //==============================================================================
+    // Interleaved kernels: one pass over a multichannel FlangerDelayLine, with the channels
+    // in the lanes of a vector. channels[c] is channel c's audio and trajectories[c] its
+    // read positions; when every channel shares one trajectory (stereo off), a frame's taps
+    // for all channels are adjacent and come in with one load per tap.
+
+    constexpr int kMaxChannels = 8;
+
+    // What a recursive interpolator carries from one block to the next, per lane. Clear it
+    // whenever the delay line is cleared.
+    template <typename SampleType>
+    struct KernelState
+    {
+        SampleType allpass[kMaxChannels] = {};
+    };
+
+    // The number of interleaved channels the kernels run for numChannels real ones:
+    // 1, 2, 4 or 8
+    constexpr int getNumLanes(int numChannels) noexcept
+    {
+        return numChannels <= 1 ? 1 : numChannels <= 2 ? 2 : numChannels <= 4 ? 4 : kMaxChannels;
+    }
+
+    template <typename Interpolator, typename SampleType>
+    SampleType interpolateStrided(const SampleType* window, int stride, float fraction) noexcept
+    {
+        SampleType taps[Interpolator::kNumTaps];
+
+        for (int tap = 0; tap < Interpolator::kNumTaps; ++tap)
+            taps[tap] = window[tap * stride];
+
+        return Interpolator()(taps, fraction);
+    }
+
+    // Runs frames [begin, end) one at a time; returns the write position after them
+    template <typename Interpolator, int NumChannels, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+    int processInterleavedScalar(SampleType* const* channels, int begin, int end, FlangerDelayLine<SampleType>& delayLine,
+                                 const FlangerModulation::Trajectory* const* trajectories,
+                                 int writePosition, Mix mix) noexcept
+    {
+        static_assert(Interpolator::kNumTaps <= FlangerDelayLine<SampleType>::kGuardSamples + 1, "window too wide");
+
+        const int mask = delayLine.getMask();
+
+        for (int i = begin; i < end; ++i)
+        {
+            const float feedback = getGain<Ramped>(mix.feedback, mix.feedbackRamp, i);
+            const float depth = getGain<Ramped>(mix.depth, mix.depthRamp, i);
+            SampleType frame[(size_t)NumChannels];
+
+            for (int channel = 0; channel < NumChannels; ++channel)
+            {
+                const auto& trajectory = *trajectories[Linked ? 0 : channel];
+                const SampleType in = channels[channel][i];
+                const SampleType interpolatedSample = interpolateStrided<Interpolator>(delayLine.getWindow(trajectory.index[i], Interpolator::kTapsBefore) + channel,
+                                                                                  NumChannels, trajectory.fraction[i]);
+
+                frame[channel] = getFeedbackSample<Feedback>(in, interpolatedSample, feedback);
+                channels[channel][i] = in + depth * interpolatedSample;
+            }
+
+            delayLine.writeFrame(writePosition, frame);
+            writePosition = (writePosition + 1) & mask;
+        }
+
+        return writePosition;
+    }
+
+    // Runs every channel of the kVectorBlock frames from first on: the output goes back into
+    // channels and the samples to feed back into frames, interleaved. Only call this when
+    // canVectorise() holds, as nothing is written to the delay line here. Portable code, for
+    // any sample type.
+    template <typename Interpolator, int NumChannels, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+    void processFrames(SampleType* const* channels, int first, const FlangerDelayLine<SampleType>& delayLine,
+                       const FlangerModulation::Trajectory* const* trajectories, Mix mix, SampleType* frames,
+                       std::false_type) noexcept
+    {
+        SampleType wet[(size_t)(kVectorBlock * NumChannels)];
+
+        for (int i = 0; i < kVectorBlock; ++i)
+        {
+            for (int channel = 0; channel < NumChannels; ++channel)
+            {
+                const auto& trajectory = *trajectories[Linked ? 0 : channel];
+                wet[i * NumChannels + channel] = interpolateStrided<Interpolator>(delayLine.getWindow(trajectory.index[first + i], Interpolator::kTapsBefore) + channel,
+                                                                                  NumChannels, trajectory.fraction[first + i]);
+            }
+        }
+
+        for (int channel = 0; channel < NumChannels; ++channel)
+        {
+            SampleType* data = channels[channel] + first;
+
+            for (int i = 0; i < kVectorBlock; ++i)
+            {
+                const SampleType in = data[i];
+                const SampleType interpolatedSample = wet[i * NumChannels + channel];
+
+                frames[i * NumChannels + channel] = getFeedbackSample<Feedback>(in, interpolatedSample,
+                                                                                getGain<Ramped>(mix.feedback, mix.feedbackRamp, first + i));
+                data[i] = in + getGain<Ramped>(mix.depth, mix.depthRamp, first + i) * interpolatedSample;
+            }
+        }
+    }
+
+   #if FLANGER_KERNEL_SSE
+    // The same for float, with the channels or frames in the lanes of SSE vectors
+    template <typename Interpolator, int NumChannels, bool Linked, bool Feedback, bool Ramped>
+    void processFrames(float* const* channels, int first, const FlangerDelayLine<float>& delayLine,
+                       const FlangerModulation::Trajectory* const* trajectories, Mix mix, float* frames,
+                       std::true_type) noexcept
+    {
+        const __m128 feedback = _mm_set1_ps(mix.feedback);
+        const __m128 depth = _mm_set1_ps(mix.depth);
+        __m128 taps[kMaxTaps];
+        static_assert(Interpolator::kNumTaps <= kMaxTaps, "the SSE kernels interpolate from up to kMaxTaps taps");
+
+        if (NumChannels == 2 && Linked)
+        {
+            // Two frames per vector: lanes are { left i, right i, left i + 1, right i + 1 }
+            float* left = channels[0];
+            float* right = channels[1];
+
+            for (int i = first; i < first + kVectorBlock; i += 2, frames += 4)
+            {
+                // Both channels' taps are adjacent: one load covers two taps of a frame,
+                // and pairing the halves of two frames' loads gives a tap of both
+                const float* window0 = delayLine.getWindow(trajectories[0]->index[i], Interpolator::kTapsBefore);
+                const float* window1 = delayLine.getWindow(trajectories[0]->index[i + 1], Interpolator::kTapsBefore);
+
+                for (int tap = 0; tap < Interpolator::kNumTaps; tap += 2)
+                {
+                    const __m128 frame0 = _mm_loadu_ps(window0 + 2 * tap);
+                    const __m128 frame1 = _mm_loadu_ps(window1 + 2 * tap);
+
+                    taps[tap] = _mm_movelh_ps(frame0, frame1);
+                    taps[tap + 1] = _mm_movehl_ps(frame1, frame0);
+                }
+
+                const __m128 fractions = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(trajectories[0]->fraction + i));
+                const __m128 interpolated = Interpolator::interpolate(taps, _mm_unpacklo_ps(fractions, fractions));
+                const __m128 in = _mm_unpacklo_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(left + i)),
+                                                  _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(right + i)));
+
+                // A ramp's gains for the two frames, each duplicated for both channels
+                __m128 frameFeedback = feedback, frameDepth = depth;
+
+                if (Ramped)
+                {
+                    frameFeedback = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(mix.feedbackRamp + i));
+                    frameFeedback = _mm_unpacklo_ps(frameFeedback, frameFeedback);
+                    frameDepth = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(mix.depthRamp + i));
+                    frameDepth = _mm_unpacklo_ps(frameDepth, frameDepth);
+                }
+
+                _mm_storeu_ps(frames, getFeedbackSample<Feedback>(in, interpolated, frameFeedback));
+
+                // Back to planar: { left i, left i + 1, right i, right i + 1 }
+                const __m128 out = _mm_add_ps(in, _mm_mul_ps(frameDepth, interpolated));
+                const __m128 planar = _mm_shuffle_ps(out, out, _MM_SHUFFLE(3, 1, 2, 0));
+                _mm_storel_pi((__m64*)(left + i), planar);
+                _mm_storeh_pi((__m64*)(right + i), planar);
+            }
+
+            return;
+        }
+
+        if (NumChannels == 2)
+        {
+            // Each channel has its own read positions, so take four frames of one channel per
+            // vector, as the mono kernel does, picking the channel out of each interleaved window
+            // four taps at a time, from tap group on
+            auto channelTaps = [](const float* window, int group, int channel)
+            {
+                const __m128 low = _mm_loadu_ps(window + 2 * group);
+                const __m128 high = Interpolator::kNumTaps - group > 2 ? _mm_loadu_ps(window + 2 * group + 4) : low;
+
+                return channel == 0 ? _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))
+                                    : _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+            };
+
+            for (int i = first; i < first + kVectorBlock; i += 4, frames += 8)
+            {
+                const __m128 frameFeedback = getGains<Ramped>(feedback, mix.feedbackRamp, i);
+                const __m128 frameDepth = getGains<Ramped>(depth, mix.depthRamp, i);
+                __m128 feedbackSamples[2];
+
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    const auto& trajectory = *trajectories[channel];
+
+                    for (int group = 0; group < Interpolator::kNumTaps; group += 4)
+                    {
+                        for (int frame = 0; frame < 4; ++frame)
+                            taps[group + frame] = channelTaps(delayLine.getWindow(trajectory.index[i + frame], Interpolator::kTapsBefore),
+                                                              group, channel);
+
+                        _MM_TRANSPOSE4_PS(taps[group], taps[group + 1], taps[group + 2], taps[group + 3]);
+                    }
+
+                    const __m128 interpolated = Interpolator::interpolate(taps, _mm_loadu_ps(trajectory.fraction + i));
+                    const __m128 in = _mm_loadu_ps(channels[channel] + i);
+
+                    feedbackSamples[channel] = getFeedbackSample<Feedback>(in, interpolated, frameFeedback);
+                    _mm_storeu_ps(channels[channel] + i, _mm_add_ps(in, _mm_mul_ps(frameDepth, interpolated)));
+                }
+
+                _mm_storeu_ps(frames, _mm_unpacklo_ps(feedbackSamples[0], feedbackSamples[1]));
+                _mm_storeu_ps(frames + 4, _mm_unpackhi_ps(feedbackSamples[0], feedbackSamples[1]));
+            }
+
+            return;
+        }
+
+        if (NumChannels % 4 == 0)
+        {
+            // Four channels of one frame per vector, four frames at a time so the
+            // results transpose into planar output
+            for (int i = first; i < first + kVectorBlock; i += 4)
+            {
+                // After the transpose below, each vector holds one channel's four frames
+                const __m128 frameFeedback = getGains<Ramped>(feedback, mix.feedbackRamp, i);
+                const __m128 frameDepth = getGains<Ramped>(depth, mix.depthRamp, i);
+
+                for (int group = 0; group < NumChannels; group += 4)
+                {
+                    __m128 interpolated[4];
+
+                    for (int frame = 0; frame < 4; ++frame)
+                    {
+                        __m128 fraction;
+
+                        if (Linked)
+                        {
+                            const float* window = delayLine.getWindow(trajectories[0]->index[i + frame], Interpolator::kTapsBefore) + group;
+
+                            for (int tap = 0; tap < Interpolator::kNumTaps; ++tap)
+                                taps[tap] = _mm_loadu_ps(window + tap * NumChannels);
+
+                            fraction = _mm_set1_ps(trajectories[0]->fraction[i + frame]);
+                        }
+                        else
+                        {
+                            const float* windows[4];
+                            float fractions[4];
+
+                            for (int lane = 0; lane < 4; ++lane)
+                            {
+                                const auto& trajectory = *trajectories[group + lane];
+                                windows[lane] = delayLine.getWindow(trajectory.index[i + frame], Interpolator::kTapsBefore) + group + lane;
+                                fractions[lane] = trajectory.fraction[i + frame];
+                            }
+
+                            for (int tap = 0; tap < Interpolator::kNumTaps; ++tap)
+                                taps[tap] = _mm_setr_ps(windows[0][tap * NumChannels], windows[1][tap * NumChannels],
+                                                        windows[2][tap * NumChannels], windows[3][tap * NumChannels]);
+
+                            fraction = _mm_loadu_ps(fractions);
+                        }
+
+                        interpolated[frame] = Interpolator::interpolate(taps, fraction);
+                    }
+
+                    _MM_TRANSPOSE4_PS(interpolated[0], interpolated[1], interpolated[2], interpolated[3]);
+
+                    __m128 feedbackSamples[4];
+
+                    for (int lane = 0; lane < 4; ++lane)
+                    {
+                        float* data = channels[group + lane] + i;
+                        const __m128 in = _mm_loadu_ps(data);
+
+                        feedbackSamples[lane] = getFeedbackSample<Feedback>(in, interpolated[lane], frameFeedback);
+                        _mm_storeu_ps(data, _mm_add_ps(in, _mm_mul_ps(frameDepth, interpolated[lane])));
+                    }
+
+                    _MM_TRANSPOSE4_PS(feedbackSamples[0], feedbackSamples[1], feedbackSamples[2], feedbackSamples[3]);
+
+                    for (int frame = 0; frame < 4; ++frame)
+                        _mm_storeu_ps(frames + (i - first + frame) * NumChannels + group, feedbackSamples[frame]);
+                }
+            }
+
+            return;
+        }
+
+        processFrames<Interpolator, NumChannels, Linked, Feedback, Ramped>(channels, first, delayLine, trajectories, mix, frames,
+                                                                           std::false_type());
+    }
+   #endif
+
+    // Runs numSamples frames of every channel, in kVectorBlock sub-blocks when the minimum
+    // delay allows it; returns the write position after them. Linked means every channel
+    // reads trajectories[0].
+    template <typename Interpolator, int NumChannels, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+    int processInterleaved(SampleType* const* channels, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                           const FlangerModulation::Trajectory* const* trajectories, int writePosition, Mix mix,
+                           int minimumDelaySamples) noexcept
+    {
+        static_assert(NumChannels == 2 || NumChannels == 4 || NumChannels == kMaxChannels, "unsupported lane count");
+
+        if (!canVectorise<Interpolator>(minimumDelaySamples))
+            return processInterleavedScalar<Interpolator, NumChannels, Linked, Feedback, Ramped>(channels, 0, numSamples, delayLine,
+                                                                                                 trajectories, writePosition, mix);
+
+        const int mask = delayLine.getMask();
+        const int vectorEnd = numSamples - numSamples % kVectorBlock;
+
+        for (int start = 0; start < vectorEnd; start += kVectorBlock)
+        {
+            SampleType frames[(size_t)(kVectorBlock * NumChannels)];
+
+            processFrames<Interpolator, NumChannels, Linked, Feedback, Ramped>(channels, start, delayLine, trajectories, mix, frames,
+                                                                               detail::UseSse<SampleType>());
+
+            delayLine.write(writePosition, frames, kVectorBlock);
+            writePosition = (writePosition + kVectorBlock) & mask;
+        }
+
+        return processInterleavedScalar<Interpolator, NumChannels, Linked, Feedback, Ramped>(channels, vectorEnd, numSamples, delayLine,
+                                                                                             trajectories, writePosition, mix);
+    }
+
+    //==============================================================================
+    // The Thiran allpass feeds each output into the next, so it runs one frame at a time
+    // whatever the minimum delay, though the channels still share one pass over the line.
+    // state.allpass[c] holds lane c's last output.
+    template <int NumChannels, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+    int processAllpass(SampleType* const* channels, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                       const FlangerModulation::Trajectory* const* trajectories, int writePosition, Mix mix,
+                       KernelState<SampleType>& state) noexcept
+    {
+        const ThiranInterpolator interpolate;
+        const int mask = delayLine.getMask();
+        SampleType previous[(size_t)NumChannels];
+
+        for (int channel = 0; channel < NumChannels; ++channel)
+            previous[channel] = state.allpass[channel];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float feedback = getGain<Ramped>(mix.feedback, mix.feedbackRamp, i);
+            const float depth = getGain<Ramped>(mix.depth, mix.depthRamp, i);
+            SampleType frame[(size_t)NumChannels];
+
+            for (int channel = 0; channel < NumChannels; ++channel)
+            {
+                const auto& trajectory = *trajectories[Linked ? 0 : channel];
+                const SampleType in = channels[channel][i];
+                const SampleType interpolatedSample = interpolate(delayLine.getWindow(trajectory.index[i], ThiranInterpolator::kTapsBefore) + channel,
+                                                             NumChannels, trajectory.fraction[i], previous[channel]);
+
+                frame[channel] = getFeedbackSample<Feedback>(in, interpolatedSample, feedback);
+                channels[channel][i] = in + depth * interpolatedSample;
+            }
+
+            delayLine.writeFrame(writePosition, frame);
+            writePosition = (writePosition + 1) & mask;
+        }
+
+        for (int channel = 0; channel < NumChannels; ++channel)
+            state.allpass[channel] = previous[channel];
+
+        return writePosition;
+    }
+
+    //==============================================================================
+    // Every combination of interpolator, lane count, linked channels, feedback and ramped
+    // gains gets its own kernel, so none of them branch on those settings inside the loops
+    // and each is vectorised for exactly its case. processBlock looks its kernel up once
+    // per block, from the table for its sample type.
+
+    template <typename SampleType>
+    using Kernel = int (*)(SampleType* const* channels, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                           const FlangerModulation::Trajectory* const* trajectories, int writePosition,
+                           Mix mix, int minimumDelaySamples, KernelState<SampleType>& state);
+
+    struct KernelSettings
+    {
+        int interpolation = kLinear;    // unknown modes fall back to linear
+        int numLanes = 1;               // the delay line's getNumChannels()
+        bool linked = true;             // every channel reads trajectories[0]
+        bool feedback = true;           // false when the feedback gain is zero
+        bool ramped = false;            // true when the Mix's ramps are set
+    };
+
+    namespace detail
+    {
+        template <typename Interpolator, int NumLanes, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+        int runKernel(SampleType* const* channels, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                      const FlangerModulation::Trajectory* const* trajectories, int writePosition,
+                      Mix mix, int minimumDelaySamples, KernelState<SampleType>&) noexcept
+        {
+            if (NumLanes == 1)
+                return process<Interpolator, Feedback, Ramped>(channels[0], numSamples, delayLine, *trajectories[0],
+                                                               writePosition, mix, minimumDelaySamples);
+
+            return processInterleaved<Interpolator, NumLanes == 1 ? 2 : NumLanes, Linked, Feedback, Ramped>(channels, numSamples, delayLine, trajectories,
+                                                                                                          writePosition, mix, minimumDelaySamples);
+        }
+
+        template <int NumLanes, bool Linked, bool Feedback, bool Ramped, typename SampleType>
+        int runAllpassKernel(SampleType* const* channels, int numSamples, FlangerDelayLine<SampleType>& delayLine,
+                             const FlangerModulation::Trajectory* const* trajectories, int writePosition,
+                             Mix mix, int, KernelState<SampleType>& state) noexcept
+        {
+            return processAllpass<NumLanes, Linked, Feedback, Ramped>(channels, numSamples, delayLine, trajectories, writePosition, mix, state);
+        }
+
+        constexpr int kNumLaneCounts = 4;   // 1, 2, 4 and 8 lanes
+
+        constexpr int getLaneCountIndex(int numLanes) noexcept
+        {
+            return numLanes >= 8 ? 3 : numLanes >= 4 ? 2 : numLanes >= 2 ? 1 : 0;
+        }
+    }
+
+    template <typename SampleType>
+    Kernel<SampleType> getKernel(const KernelSettings& settings) noexcept
+    {
+       #define FLANGER_KERNEL(Interpolator, lanes, linked, feedback, ramped) \
+        detail::runKernel<Interpolator, lanes, linked, feedback, ramped, SampleType>
+
+       #define FLANGER_KERNELS(Interpolator, lanes) \
+        { { { FLANGER_KERNEL(Interpolator, lanes, false, false, false), FLANGER_KERNEL(Interpolator, lanes, false, false, true) }, \
+            { FLANGER_KERNEL(Interpolator, lanes, false, true, false),  FLANGER_KERNEL(Interpolator, lanes, false, true, true) } }, \
+          { { FLANGER_KERNEL(Interpolator, lanes, true, false, false),  FLANGER_KERNEL(Interpolator, lanes, true, false, true) }, \
+            { FLANGER_KERNEL(Interpolator, lanes, true, true, false),   FLANGER_KERNEL(Interpolator, lanes, true, true, true) } } }
+
+       #define FLANGER_ALLPASS_KERNEL(lanes, linked, feedback, ramped) \
+        detail::runAllpassKernel<lanes, linked, feedback, ramped, SampleType>
+
+       #define FLANGER_ALLPASS_KERNELS(lanes) \
+        { { { FLANGER_ALLPASS_KERNEL(lanes, false, false, false), FLANGER_ALLPASS_KERNEL(lanes, false, false, true) }, \
+            { FLANGER_ALLPASS_KERNEL(lanes, false, true, false),  FLANGER_ALLPASS_KERNEL(lanes, false, true, true) } }, \
+          { { FLANGER_ALLPASS_KERNEL(lanes, true, false, false),  FLANGER_ALLPASS_KERNEL(lanes, true, false, true) }, \
+            { FLANGER_ALLPASS_KERNEL(lanes, true, true, false),   FLANGER_ALLPASS_KERNEL(lanes, true, true, true) } } }
+
+        // [interpolation][lane count][linked][feedback][ramped]
+        static constexpr Kernel<SampleType> kernels[kNumInterpolations][detail::kNumLaneCounts][2][2][2] =
+        {
+            { FLANGER_KERNELS(LinearInterpolator, 1), FLANGER_KERNELS(LinearInterpolator, 2),
+              FLANGER_KERNELS(LinearInterpolator, 4), FLANGER_KERNELS(LinearInterpolator, 8) },
+            { FLANGER_KERNELS(QuadraticInterpolator, 1), FLANGER_KERNELS(QuadraticInterpolator, 2),
+              FLANGER_KERNELS(QuadraticInterpolator, 4), FLANGER_KERNELS(QuadraticInterpolator, 8) },
+            { FLANGER_KERNELS(CubicInterpolator, 1), FLANGER_KERNELS(CubicInterpolator, 2),
+              FLANGER_KERNELS(CubicInterpolator, 4), FLANGER_KERNELS(CubicInterpolator, 8) },
+            { FLANGER_KERNELS(Lagrange3Interpolator, 1), FLANGER_KERNELS(Lagrange3Interpolator, 2),
+              FLANGER_KERNELS(Lagrange3Interpolator, 4), FLANGER_KERNELS(Lagrange3Interpolator, 8) },
+            { FLANGER_KERNELS(Lagrange5Interpolator, 1), FLANGER_KERNELS(Lagrange5Interpolator, 2),
+              FLANGER_KERNELS(Lagrange5Interpolator, 4), FLANGER_KERNELS(Lagrange5Interpolator, 8) },
+            { FLANGER_KERNELS(SincInterpolator, 1), FLANGER_KERNELS(SincInterpolator, 2),
+              FLANGER_KERNELS(SincInterpolator, 4), FLANGER_KERNELS(SincInterpolator, 8) },
+            { FLANGER_ALLPASS_KERNELS(1), FLANGER_ALLPASS_KERNELS(2),
+              FLANGER_ALLPASS_KERNELS(4), FLANGER_ALLPASS_KERNELS(8) }
+        };
+
+       #undef FLANGER_KERNEL
+       #undef FLANGER_KERNELS
+       #undef FLANGER_ALLPASS_KERNEL
+       #undef FLANGER_ALLPASS_KERNELS
+
+        const int interpolation = settings.interpolation >= 0 && settings.interpolation < kNumInterpolations
+                                    ? settings.interpolation : kLinear;
+
+        return kernels[interpolation][detail::getLaneCountIndex(settings.numLanes)][settings.linked ? 1 : 0]
+                      [settings.feedback ? 1 : 0][settings.ramped ? 1 : 0];
+    }
+}
@@ -0,0 +1,183 @@
+/*
+  ==============================================================================
+
+    Table-driven LFO for the flanger's delay modulation.
+
+    One table per waveform is generated at compile time and read with linear
+    interpolation, driven by a 32-bit phase accumulator: a full cycle is 2^32,
+    so the phase wraps for free and, being an integer, never drifts however
+    long the session runs. All waveforms run between 0 and 1.
+
+    Square and saw round off their edges over kEdgeWidth of a cycle, so the
+    delay time glides instead of jumping (which would click).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace FlangerLfo
+{
+    using Phase = uint32_t;
+
+    enum Waveform
+    {
+        kSine = 0,
+        kTriangle,
+        kSquare,
+        kSaw,
+        kNumWaveforms
+    };
+
+    constexpr int kTableBits = 10;
+    constexpr int kTableSize = 1 << kTableBits;
+    constexpr int kFractionBits = 32 - kTableBits;
+
+    constexpr double kEdgeWidth = 1.0 / 32.0;     // fraction of a cycle each square/saw edge takes
+    constexpr Phase kQuarterCycle = 0x40000000u;  // phase offset of the second channel in stereo mode
+
+    //==============================================================================
+    namespace detail
+    {
+        constexpr double pi = 3.141592653589793238;
+
+        // Taylor series, folded into [-pi/2, pi/2] where it converges to double precision
+        constexpr double sine(double x)
+        {
+            while (x > pi)
+                x -= 2.0 * pi;
+
+            while (x < -pi)
+                x += 2.0 * pi;
+
+            if (x > 0.5 * pi)
+                x = pi - x;
+            else if (x < -0.5 * pi)
+                x = -pi - x;
+
+            double term = x, sum = x;
+
+            for (int n = 1; n < 12; ++n)
+            {
+                term *= -x * x / (double)((2 * n) * (2 * n + 1));
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        // Rises from 0 to 1 as t goes from 0 to 1, with zero slope at both ends
+        constexpr double raisedCosine(double t)
+        {
+            return 0.5 - 0.5 * sine(0.5 * pi - pi * t);
+        }
+
+        // Phase 0 starts every waveform where the original lfo() shapes did
+        constexpr double shape(int waveform, double phase)
+        {
+            switch (waveform)
+            {
+            case kTriangle:
+                if (phase < 0.25)
+                    return 0.5 + 2.0 * phase;
+                else if (phase < 0.75)
+                    return 1.0 - 2.0 * (phase - 0.25);
+                else
+                    return 2.0 * (phase - 0.75);
+
+            case kSquare:
+            {
+                // High for the first half cycle, edges centred on 0.5 and 1.0
+                const double halfEdge = 0.5 * kEdgeWidth;
+
+                if (phase < halfEdge)
+                    return raisedCosine(0.5 + phase / kEdgeWidth);
+                else if (phase < 0.5 - halfEdge)
+                    return 1.0;
+                else if (phase < 0.5 + halfEdge)
+                    return 1.0 - raisedCosine((phase - (0.5 - halfEdge)) / kEdgeWidth);
+                else if (phase < 1.0 - halfEdge)
+                    return 0.0;
+                else
+                    return raisedCosine((phase - (1.0 - halfEdge)) / kEdgeWidth);
+            }
+
+            case kSaw:
+            {
+                // Ramps up through 0.5 at phase 0, falls back to 0 around phase 0.5
+                double u = phase + 0.5 - 0.5 * kEdgeWidth;
+
+                if (u >= 1.0)
+                    u -= 1.0;
+
+                if (u < 1.0 - kEdgeWidth)
+                    return u / (1.0 - kEdgeWidth);
+                else
+                    return 1.0 - raisedCosine((u - (1.0 - kEdgeWidth)) / kEdgeWidth);
+            }
+
+            case kSine:
+            default:
+                return 0.5 + 0.5 * sine(2.0 * pi * phase);
+            }
+        }
+
+        // One extra entry repeating the first, so interpolation never has to wrap
+        struct Table
+        {
+            float values[kTableSize + 1];
+        };
+
+        constexpr Table makeTable(int waveform)
+        {
+            Table table {};
+
+            for (int i = 0; i < kTableSize; ++i)
+                table.values[i] = (float)shape(waveform, (double)i / (double)kTableSize);
+
+            table.values[kTableSize] = table.values[0];
+            return table;
+        }
+
+        // Each table is its own constant so it gets its own constant evaluation: generated
+        // in a single initialiser, the four together come near MSVC's default /constexpr:steps
+        constexpr Table sineTable = makeTable(kSine);
+        constexpr Table triangleTable = makeTable(kTriangle);
+        constexpr Table squareTable = makeTable(kSquare);
+        constexpr Table sawTable = makeTable(kSaw);
+
+        constexpr const float* tables[kNumWaveforms] = { sineTable.values, triangleTable.values,
+                                                         squareTable.values, sawTable.values };
+    }
+
+    //==============================================================================
+    // Unknown waveforms fall back to the sine, like the old switch did
+    inline const float* getTable(int waveform) noexcept
+    {
+        return detail::tables[waveform >= 0 && waveform < kNumWaveforms ? waveform : kSine];
+    }
+
+    inline float lookup(const float* table, Phase phase) noexcept
+    {
+        constexpr float fractionScale = 1.0f / (float)(1u << kFractionBits);
+
+        const auto index = phase >> kFractionBits;
+        const float fraction = (float)(int32_t)(phase & ((1u << kFractionBits) - 1u)) * fractionScale;
+
+        return table[index] + fraction * (table[index + 1] - table[index]);
+    }
+
+    // Accumulator step for an LFO of frequency Hz. Rounded to the nearest step,
+    // so the rate is exact to within 2^-32 of the sample rate.
+    inline Phase getPhaseIncrement(double frequency, double inverseSampleRate) noexcept
+    {
+        const double cycles = frequency * inverseSampleRate;
+
+        if (!(cycles > 0.0))
+            return 0;
+
+        return (Phase)(int64_t)((cycles - (double)(int64_t)cycles) * 4294967296.0 + 0.5);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    Block-rate modulation stage of the flanger.
+
+  ==============================================================================
+*/
+
+#include "FlangerModulation.h"
+
+void FlangerModulation::prepare(int newMaxBlockSize)
+{
+    maxBlockSize = newMaxBlockSize > 0 ? newMaxBlockSize : 1;
+}
+
+size_t FlangerModulation::getScratchSize(int numSamples) noexcept
+{
+    const size_t n = (size_t)numSamples;
+
+    return 2 * FlangerScratchArena::getAllocationSize<float>(n)
+           + kMaxTrajectories * (FlangerScratchArena::getAllocationSize<int>(n) + FlangerScratchArena::getAllocationSize<float>(n));
+}
+
+bool FlangerModulation::prepareBlock(FlangerScratchArena& arena, int numSamples) noexcept
+{
+    const size_t n = (size_t)numSamples;
+
+    lfoValues = arena.allocate<float>(n);
+    delaySamples = arena.allocate<float>(n);
+    bool allocated = lfoValues != nullptr && delaySamples != nullptr;
+
+    for (int slot = 0; slot < kMaxTrajectories; ++slot)
+    {
+        indices[slot] = arena.allocate<int>(n);
+        fractions[slot] = arena.allocate<float>(n);
+        allocated = allocated && indices[slot] != nullptr && fractions[slot] != nullptr;
+    }
+
+    return allocated;
+}
+
+FlangerModulation::Trajectory FlangerModulation::compute(int slot, FlangerLfo::Phase startPhase, int writePosition,
+                                                         int numSamples, const Settings& settings) noexcept
+{
+    float* lfo = lfoValues;
+    float* delay = delaySamples;
+    int* index = indices[slot];
+    float* fraction = fractions[slot];
+
+    // Copied into locals so the compiler can tell they don't alias the outputs
+    const float* lfoTable = settings.lfoTable;
+    const FlangerLfo::Phase phaseIncrement = settings.phaseIncrement;
+    const FlangerLfo::Phase* phaseIncrementRamp = settings.phaseIncrementRamp;
+    const float delayMs = settings.delayMs;
+    const float sweepMs = settings.sweepMs;
+    const float* delayMsRamp = settings.delayMsRamp;
+    const float* sweepMsRamp = settings.sweepMsRamp;
+    const float samplesPerMs = settings.samplesPerMs;
+    const int delayMask = settings.delayMask;
+
+    // The phase of sample i is startPhase + i * increment, wrapping modulo 2^32. While the
+    // rate moves, every sample has its own increment, so the phases are summed up instead.
+    if (phaseIncrementRamp == nullptr)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            lfo[i] = FlangerLfo::lookup(lfoTable, startPhase + (FlangerLfo::Phase)i * phaseIncrement);
+    }
+    else
+    {
+        FlangerLfo::Phase phase = startPhase;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            lfo[i] = FlangerLfo::lookup(lfoTable, phase);
+            phase += phaseIncrementRamp[i];
+        }
+    }
+
+    if (delayMsRamp == nullptr)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            delay[i] = (delayMs + sweepMs * lfo[i]) * samplesPerMs;
+    }
+    else
+    {
+        for (int i = 0; i < numSamples; ++i)
+            delay[i] = (delayMsRamp[i] + sweepMsRamp[i] * lfo[i]) * samplesPerMs;
+    }
+
+    // The tap sits delay[i] samples behind the write pointer. Splitting the delay
+    // into whole and fractional samples keeps the fraction exact, where a single
+    // float position would lose precision as the write pointer grows.
+    //
+    // The delay is never negative, so truncation is floor(). The loop is kept free
+    // of branches (the fold is a mask) so it vectorises; rebuilding each position
+    // like this measured faster than stepping the previous one by the delay's
+    // derivative, which is a serial dependency and accumulates rounding.
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int whole = (int)delay[i];
+        const float part = delay[i] - (float)whole;
+        const int carry = part > 0.0f;
+
+        index[i] = (writePosition + i - whole - carry) & delayMask;
+        fraction[i] = (float)carry - part;
+    }
+
+    return { index, fraction };
+}
+
+FlangerLfo::Phase FlangerModulation::advance(FlangerLfo::Phase startPhase, int numSamples, const Settings& settings) noexcept
+{
+    if (settings.phaseIncrementRamp == nullptr)
+        return startPhase + (FlangerLfo::Phase)numSamples * settings.phaseIncrement;
+
+    for (int i = 0; i < numSamples; ++i)
+        startPhase += settings.phaseIncrementRamp[i];
+
+    return startPhase;
+}
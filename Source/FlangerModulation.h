@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    Block-rate modulation stage of the flanger.
+
+    Turns the LFO into the read positions for a whole block at once: for each
+    sample, the index of the delay line sample at or before the tap plus the
+    fraction of a sample towards the one after it. The kernel that follows
+    only has to gather and interpolate, and channels that share an LFO phase
+    share a trajectory.
+
+    Each step runs as its own loop over plain arrays so the compiler can
+    vectorise it. The arrays are taken from a FlangerScratchArena for each
+    block, next to the rest of the block's working memory.
+
+    While the delay, sweep or LFO rate is being smoothed, the settings point
+    at ramps of per-sample values for it instead (see FlangerSmoother).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "FlangerLfo.h"
+#include "FlangerScratchArena.h"
+
+#include <cstddef>
+
+class FlangerModulation
+{
+public:
+    static constexpr int kMaxTrajectories = 2;  // channel 0 and, in stereo mode, the quadrature channel
+
+    struct Settings
+    {
+        float delayMs = 0.0f;
+        float sweepMs = 0.0f;
+        float samplesPerMs = 0.0f;
+        const float* lfoTable = nullptr;
+        FlangerLfo::Phase phaseIncrement = 0;
+        int delayMask = 0;  // circular delay buffer length (a power of two) minus one
+
+        // Set together, to every sample's delay and sweep, while either is being smoothed;
+        // delayMs and sweepMs are ignored then
+        const float* delayMsRamp = nullptr;
+        const float* sweepMsRamp = nullptr;
+
+        // Set to every sample's phase increment while the LFO rate is being smoothed;
+        // phaseIncrement is ignored then
+        const FlangerLfo::Phase* phaseIncrementRamp = nullptr;
+    };
+
+    struct Trajectory
+    {
+        const int* index = nullptr;       // delay buffer sample at or before the read position
+        const float* fraction = nullptr;  // 0 <= fraction < 1, towards index + 1
+    };
+
+    // Sets the longest block compute() will be asked for
+    void prepare(int maxBlockSize);
+
+    int getMaxBlockSize() const noexcept { return maxBlockSize; }
+
+    // How much arena prepareBlock() takes for a block of numSamples
+    static size_t getScratchSize(int numSamples) noexcept;
+
+    // Takes the arrays for a block of numSamples <= getMaxBlockSize() samples from arena.
+    // Call it after every reset of the arena, before compute(). Returns false, and
+    // compute() mustn't be called, if the arena didn't have room for them.
+    bool prepareBlock(FlangerScratchArena& arena, int numSamples) noexcept;
+
+    // Fills trajectory slot (0 or 1) for up to the numSamples given to prepareBlock(),
+    // starting at LFO phase startPhase with the delay's write pointer at writePosition.
+    // The result stays valid until the slot is filled again or the arena is reset.
+    Trajectory compute(int slot, FlangerLfo::Phase startPhase, int writePosition,
+                       int numSamples, const Settings& settings) noexcept;
+
+    // The LFO phase numSamples samples after startPhase
+    static FlangerLfo::Phase advance(FlangerLfo::Phase startPhase, int numSamples, const Settings& settings) noexcept;
+
+private:
+    int maxBlockSize = 0;
+
+    // This block's arrays, in the arena
+    float* lfoValues = nullptr;
+    float* delaySamples = nullptr;
+    int* indices[kMaxTrajectories] = {};
+    float* fractions[kMaxTrajectories] = {};
+};
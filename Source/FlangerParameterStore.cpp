@@ -0,0 +1,31 @@
+/*
+  ==============================================================================
+
+    Lock-free storage for the flanger's parameter values.
+
+  ==============================================================================
+*/
+
+#include "FlangerParameterStore.h"
+
+#include <new>
+
+static_assert(sizeof(std::atomic<float>) <= FlangerParameterStore::kCacheLineSize
+              && sizeof(std::atomic<uint32_t>) <= FlangerParameterStore::kCacheLineSize,
+              "every atomic needs to fit on its line");
+
+FlangerParameterStore::FlangerParameterStore(int newNumValues)
+    : numValues(newNumValues > 0 ? newNumValues : 0)
+{
+    const size_t numLines = (size_t)numValues + 1;
+
+    memory.reset(new unsigned char[(numLines + 1) * kCacheLineSize]);
+
+    const auto address = reinterpret_cast<uintptr_t>(memory.get());
+    lines = memory.get() + (kCacheLineSize - address % kCacheLineSize) % kCacheLineSize;
+
+    for (int index = 0; index < numValues; ++index)
+        new (lines + (size_t)index * kCacheLineSize) std::atomic<float>(0.0f);
+
+    new (lines + (size_t)numValues * kCacheLineSize) std::atomic<uint32_t>(0);
+}
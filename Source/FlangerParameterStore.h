@@ -0,0 +1,68 @@
+/*
+  ==============================================================================
+
+    Lock-free storage for the flanger's parameter values.
+
+    Each value is a std::atomic<float> on a cache line of its own, so the
+    threads that set parameters (the message thread, or a host's automation
+    thread) never share a line with anything the audio thread reads besides
+    the value itself. A version counter moves after every write, so the audio
+    thread can take its per-block snapshot with a single atomic load while
+    nothing changes, and only rereads the values when something has.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class FlangerParameterStore
+{
+public:
+    static constexpr size_t kCacheLineSize = 64;
+
+    // Every value starts out at zero
+    explicit FlangerParameterStore(int numValues);
+
+    int getNumValues() const noexcept { return numValues; }
+
+    // Any thread, lock-free
+    void set(int index, float value) noexcept
+    {
+        getSlot(index).store(value, std::memory_order_relaxed);
+        getVersionSlot().fetch_add(1, std::memory_order_release);
+    }
+
+    float get(int index) const noexcept
+    {
+        return getSlot(index).load(std::memory_order_relaxed);
+    }
+
+    // Read this before the values: if it's the same as last time, none of them has changed
+    // since, and if it isn't, every value written before it moved is visible.
+    uint32_t getVersion() const noexcept
+    {
+        return getVersionSlot().load(std::memory_order_acquire);
+    }
+
+private:
+    // The lines are allocated by hand rather than as alignas() members, which C++14's
+    // operator new wouldn't align: one per value, then one for the version
+    std::atomic<float>& getSlot(int index) const noexcept
+    {
+        return *reinterpret_cast<std::atomic<float>*>(lines + (size_t)index * kCacheLineSize);
+    }
+
+    std::atomic<uint32_t>& getVersionSlot() const noexcept
+    {
+        return *reinterpret_cast<std::atomic<uint32_t>*>(lines + (size_t)numValues * kCacheLineSize);
+    }
+
+    int numValues;
+    std::unique_ptr<unsigned char[]> memory;
+    unsigned char* lines = nullptr;     // memory, rounded up to a cache line boundary
+};
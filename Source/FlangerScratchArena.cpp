@@ -0,0 +1,23 @@
+/*
+  ==============================================================================
+
+    Per-instance scratch memory for the flanger's block stages.
+
+  ==============================================================================
+*/
+
+#include "FlangerScratchArena.h"
+
+void FlangerScratchArena::prepare(size_t numBytes)
+{
+    used = 0;
+
+    if (numBytes <= capacity)
+        return;
+
+    capacity = getAllocationSize<unsigned char>(numBytes);
+    memory.reset(new unsigned char[capacity + kAlignment]);
+
+    const auto address = reinterpret_cast<uintptr_t>(memory.get());
+    base = memory.get() + (kAlignment - address % kAlignment) % kAlignment;
+}
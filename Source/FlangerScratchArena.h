@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    Per-instance scratch memory for the flanger's block stages.
+
+    One buffer is allocated in prepareToPlay, big enough for everything a
+    block needs at the largest block size announced, and handed out by
+    bumping an offset. Nothing is ever freed on its own: reset() at the start
+    of a block makes the whole arena available again. The modulation
+    trajectories, smoothing ramps and so on then sit next to each other in
+    one region that stays warm in cache from block to block, and the audio
+    thread never allocates.
+
+    Every allocation starts on a cache line, so the stages' loops can use
+    aligned vector loads and no two arrays share a line.
+
+    Running out is a bug in whoever sized the arena. It asserts in debug
+    builds; in release allocate() returns nullptr, and the caller skips the
+    stage instead of writing past the end.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class FlangerScratchArena
+{
+public:
+    static constexpr size_t kAlignment = 64;
+
+    // How much of the arena allocate<T>(numElements) takes, for adding up the size to prepare()
+    template <typename T>
+    static constexpr size_t getAllocationSize(size_t numElements) noexcept
+    {
+        return (numElements * sizeof(T) + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    // Makes room for numBytes worth of allocations, and rewinds. Reuses the memory it
+    // already has if that's enough, so only a prepare for larger blocks allocates.
+    void prepare(size_t numBytes);
+
+    // Makes everything handed out so far available again
+    void reset() noexcept { used = 0; }
+
+    // numElements uninitialised Ts, aligned to kAlignment, valid until the next reset().
+    // What's allocated between resets must fit in what prepare() made room for; if it
+    // doesn't, the result is nullptr.
+    template <typename T>
+    T* allocate(size_t numElements) noexcept
+    {
+        const size_t size = getAllocationSize<T>(numElements);
+        jassert(used + size <= capacity);
+
+        if (used + size > capacity)
+            return nullptr;
+
+        T* result = reinterpret_cast<T*>(base + used);
+        used += size;
+        return result;
+    }
+
+    size_t getCapacity() const noexcept { return capacity; }
+    size_t getUsed() const noexcept { return used; }
+
+private:
+    std::unique_ptr<unsigned char[]> memory;
+    unsigned char* base = nullptr;      // memory, rounded up to a kAlignment boundary
+    size_t capacity = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    Block-rate parameter smoothing for the flanger.
+
+  ==============================================================================
+*/
+
+#include "FlangerSmoother.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // How close an exponential ramp gets to its target before snapping onto it
+    constexpr double kExponentialFloor = 0.001;
+}
+
+void FlangerSmoother::reset(float value) noexcept
+{
+    current = target = value;
+    remaining = 0;
+}
+
+void FlangerSmoother::setTarget(float newTarget, int rampLength) noexcept
+{
+    // Already heading there. An exact comparison spelled with < and >, which
+    // -Wfloat-equal accepts; it also ignores a NaN target rather than ramping to it.
+    if (! (newTarget < target) && ! (newTarget > target))
+        return;
+
+    if (rampLength < 1)
+    {
+        reset(newTarget);
+        return;
+    }
+
+    target = newTarget;
+    remaining = rampLength;
+
+    if (shape == kLinear)
+    {
+        start = current;
+        step = (target - current) / (float)rampLength;
+        elapsed = 0;
+    }
+    else if (rampLength != decayLength)
+    {
+        const double factor = std::pow(kExponentialFloor, 1.0 / rampLength);
+
+        for (int i = 0; i < 4; ++i)
+            decay[i] = (float)std::pow(factor, i + 1);
+
+        decayLength = rampLength;
+    }
+}
+
+void FlangerSmoother::process(float* ramp, int numSamples) noexcept
+{
+    const int moving = std::min(numSamples, remaining);
+
+    // Locals, so the compiler can tell they don't alias the ramp
+    const float end = target;
+
+    if (shape == kLinear)
+    {
+        const float origin = start;
+        const float increment = step;
+        const int first = elapsed + 1;
+
+        // Each value from the start of the ramp rather than the one before, so the loop
+        // has no serial dependency and vectorises
+        for (int i = 0; i < moving; ++i)
+            ramp[i] = origin + increment * (float)(first + i);
+
+        elapsed += moving;
+        current = origin + increment * (float)elapsed;
+    }
+    else
+    {
+        // Four samples at a time, each from the distance at the start of its group, so
+        // only one multiply per group depends on the group before
+        const float d1 = decay[0], d2 = decay[1], d3 = decay[2], d4 = decay[3];
+        float distance = current - end;
+        int i = 0;
+
+        for (; i + 4 <= moving; i += 4)
+        {
+            ramp[i]     = end + distance * d1;
+            ramp[i + 1] = end + distance * d2;
+            ramp[i + 2] = end + distance * d3;
+            ramp[i + 3] = end + distance * d4;
+            distance *= d4;
+        }
+
+        for (; i < moving; ++i)
+        {
+            distance *= d1;
+            ramp[i] = end + distance;
+        }
+
+        current = end + distance;
+    }
+
+    remaining -= moving;
+
+    // The last sample of a ramp lands exactly on the target, and so does everything after it
+    if (remaining == 0)
+    {
+        current = end;
+
+        if (moving > 0)
+            ramp[moving - 1] = end;
+    }
+
+    std::fill(ramp + moving, ramp + numSamples, end);
+}
@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    Block-rate parameter smoothing for the flanger.
+
+    Instead of stepping a juce::SmoothedValue per sample inside the kernels,
+    a smoother writes a whole block's worth of values into a ramp buffer at
+    once, in loops the compiler can vectorise, and the kernels specialised for
+    ramps read them from there. A parameter that isn't moving costs nothing:
+    isSmoothing() is false, no ramp is written, and the kernels keep using the
+    plain constant.
+
+    Linear ramps reach the target in exactly the ramp length, and every value
+    is worked out from the start of the ramp, so they come out the same however
+    the ramp is split into blocks. Exponential ones close the distance by the
+    same factor every sample, reaching -60 dB of it after the ramp length, at
+    which point they snap onto the target.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+class FlangerSmoother
+{
+public:
+    enum Shape
+    {
+        kLinear = 0,
+        kExponential
+    };
+
+    explicit FlangerSmoother(Shape newShape = kLinear) noexcept : shape(newShape) {}
+
+    // Jumps straight to value, abandoning any ramp in progress
+    void reset(float value) noexcept;
+
+    // Ramps from the current value to target over rampLength samples, or jumps there if
+    // rampLength < 1. Does nothing if target is already the target, so it's fine to call
+    // every block with the latest parameter value.
+    void setTarget(float target, int rampLength) noexcept;
+
+    bool isSmoothing() const noexcept { return remaining > 0; }
+
+    float getCurrentValue() const noexcept { return current; }
+    float getTargetValue() const noexcept { return target; }
+
+    // Writes the values of the next numSamples samples into ramp and moves past them
+    void process(float* ramp, int numSamples) noexcept;
+
+private:
+    Shape shape;
+    float current = 0.0f;
+    float target = 0.0f;
+    int remaining = 0;
+
+    // Linear: where the ramp started, the change per sample and the samples since
+    float start = 0.0f;
+    float step = 0.0f;
+    int elapsed = 0;
+
+    // Exponential: the factor the distance to the target shrinks by over 1, 2, 3 and 4 samples,
+    // worked out for ramps decayLength long. The ramp length only changes with the rate,
+    // so they're only recalculated then, not for every new target.
+    float decay[4] = {};
+    int decayLength = 0;
+};
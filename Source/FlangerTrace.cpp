@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    Scoped trace markers for profiling the DSP stages.
+
+  ==============================================================================
+*/
+
+#include "FlangerTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace FlangerTrace
+{
+    int64_t getTimeNs() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+#if FLANGER_ENABLE_TRACE
+    namespace
+    {
+        struct Event
+        {
+            const char* name;
+            int64_t startNs;
+            int64_t endNs;
+        };
+
+        struct ThreadRing
+        {
+            std::atomic<uint64_t> numWritten { 0 };
+            Event events[eventsPerThread];
+        };
+
+        // Static storage, so claiming a ring on the audio thread never allocates
+        ThreadRing rings[maxThreads];
+        std::atomic<int> numRingsClaimed { 0 };
+        thread_local int threadRing = -1;
+
+        const int64_t originNs = getTimeNs();
+    }
+
+    void recordEvent(const char* name, int64_t startNs, int64_t endNs) noexcept
+    {
+        if (threadRing < 0)
+        {
+            threadRing = numRingsClaimed.fetch_add(1);
+
+            if (threadRing >= maxThreads)
+                return; // leaves threadRing out of range, so this thread stays dropped
+        }
+
+        if (threadRing >= maxThreads)
+            return;
+
+        auto& ring = rings[threadRing];
+        const auto index = ring.numWritten.load(std::memory_order_relaxed);
+        ring.events[index & (eventsPerThread - 1)] = { name, startNs, endNs };
+        ring.numWritten.store(index + 1, std::memory_order_release);
+    }
+
+    std::string toChromeTraceJson()
+    {
+        std::ostringstream json;
+        json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        bool first = true;
+        const int numRings = std::min(numRingsClaimed.load(), maxThreads);
+
+        for (int tid = 0; tid < numRings; ++tid)
+        {
+            const auto& ring = rings[tid];
+            const auto numWritten = ring.numWritten.load(std::memory_order_acquire);
+            const auto begin = numWritten > (uint64_t)eventsPerThread ? numWritten - eventsPerThread : 0;
+
+            for (auto i = begin; i < numWritten; ++i)
+            {
+                const auto& event = ring.events[i & (eventsPerThread - 1)];
+
+                // Complete ("X") events, timestamps in microseconds
+                json << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                     << ",\"ts\":" << (double)(event.startNs - originNs) * 1.0e-3
+                     << ",\"dur\":" << (double)(event.endNs - event.startNs) * 1.0e-3 << "}";
+                first = false;
+            }
+        }
+
+        json << "\n]}\n";
+        return json.str();
+    }
+
+    void clear()
+    {
+        for (auto& ring : rings)
+            ring.numWritten.store(0, std::memory_order_relaxed);
+    }
+#else
+    void recordEvent(const char*, int64_t, int64_t) noexcept {}
+    std::string toChromeTraceJson() { return "{\"traceEvents\":[]}\n"; }
+    void clear() {}
+#endif
+
+    bool writeChromeTrace(const std::string& filePath)
+    {
+        std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+        file << toChromeTraceJson();
+        return file.good();
+    }
+}
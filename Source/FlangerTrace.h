@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    Scoped trace markers for profiling the DSP stages.
+
+    FLANGER_TRACE_SCOPE("name") records how long the enclosing scope took into
+    a preallocated per-thread ring buffer, which can later be written out as
+    Chrome trace-event JSON (open it in chrome://tracing or ui.perfetto.dev).
+
+    The markers compile to nothing unless FLANGER_ENABLE_TRACE is defined to 1,
+    so shipped builds pay nothing for them. Names must be string literals.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifndef FLANGER_ENABLE_TRACE
+ #define FLANGER_ENABLE_TRACE 0
+#endif
+
+namespace FlangerTrace
+{
+    // Each thread that records events gets its own ring of this many events;
+    // once it is full the oldest events are overwritten
+    constexpr int maxThreads = 16;
+    constexpr int eventsPerThread = 1 << 16;
+
+    int64_t getTimeNs() noexcept;
+
+    // Lock- and allocation-free; events from more than maxThreads threads are dropped
+    void recordEvent(const char* name, int64_t startNs, int64_t endNs) noexcept;
+
+    // Everything recorded so far, as a Chrome trace-event JSON document.
+    // Best called while the audio thread is idle, since a ring that is being
+    // written to while it's read can contain a torn event.
+    std::string toChromeTraceJson();
+    bool writeChromeTrace(const std::string& filePath);
+
+    // Forgets all recorded events; must not race with recordEvent()
+    void clear();
+
+    constexpr bool isEnabled() noexcept { return FLANGER_ENABLE_TRACE != 0; }
+
+    class ScopedEvent
+    {
+    public:
+        explicit ScopedEvent(const char* eventName) noexcept : name(eventName), startNs(getTimeNs()) {}
+        ~ScopedEvent() { recordEvent(name, startNs, getTimeNs()); }
+
+        ScopedEvent(const ScopedEvent&) = delete;
+        ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+    private:
+        const char* name;
+        int64_t startNs;
+    };
+}
+
+#define FLANGER_TRACE_JOIN_INNER(a, b) a##b
+#define FLANGER_TRACE_JOIN(a, b) FLANGER_TRACE_JOIN_INNER(a, b)
+
+#if FLANGER_ENABLE_TRACE
+ #define FLANGER_TRACE_SCOPE(name) const FlangerTrace::ScopedEvent FLANGER_TRACE_JOIN(flangerTraceEvent, __LINE__) (name)
+#else
+ #define FLANGER_TRACE_SCOPE(name)
+#endif
@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    Hardware performance counters for the calling thread (Linux only).
+
+  ==============================================================================
+*/
+
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+ #include <linux/perf_event.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+ #include <cerrno>
+ #include <cstring>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+    struct CounterConfig
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    constexpr uint64_t cacheReadMiss(uint64_t cache)
+    {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    const CounterConfig counterConfigs[PerfCounters::kNumCounters] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D) },
+        { PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL) },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+    };
+
+    // Matches PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING
+    struct CounterReading
+    {
+        uint64_t value;
+        uint64_t timeEnabled;
+        uint64_t timeRunning;
+    };
+#endif
+}
+
+PerfCounters::PerfCounters()
+{
+    fds.fill(-1);
+
+#if defined(__linux__)
+    for (int i = 0; i < kNumCounters; ++i)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counterConfigs[i].type;
+        attr.config = counterConfigs[i].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        // This thread, any CPU, no group: each counter stands or falls on its own
+        fds[(size_t)i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+        if (fds[(size_t)i] < 0 && unavailableReason.empty())
+            unavailableReason = std::string(getName((Counter)i)) + ": perf_event_open: " + std::strerror(errno);
+    }
+#else
+    unavailableReason = "hardware counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (auto fd : fds)
+        if (fd >= 0)
+            close(fd);
+#endif
+}
+
+bool PerfCounters::isAvailable() const noexcept
+{
+    for (auto fd : fds)
+        if (fd >= 0)
+            return true;
+
+    return false;
+}
+
+PerfCounters::Values PerfCounters::read() const noexcept
+{
+    Values values {};
+
+#if defined(__linux__)
+    for (size_t i = 0; i < fds.size(); ++i)
+    {
+        CounterReading reading;
+
+        if (fds[i] >= 0 && ::read(fds[i], &reading, sizeof(reading)) == (ssize_t)sizeof(reading) && reading.timeRunning > 0)
+            values[i] = reading.timeRunning == reading.timeEnabled
+                          ? reading.value
+                          : (uint64_t)((double)reading.value * (double)reading.timeEnabled / (double)reading.timeRunning);
+    }
+#endif
+
+    return values;
+}
+
+const char* PerfCounters::getName(Counter counter) noexcept
+{
+    switch (counter)
+    {
+    case kCycles: return "cycles";
+    case kInstructions: return "instructions";
+    case kL1DataMisses: return "l1d_misses";
+    case kLastLevelMisses: return "llc_misses";
+    case kBranchMisses: return "branch_misses";
+    case kNumCounters: break;
+    }
+
+    return "";
+}
+
+//==============================================================================
+void PerfCounters::Totals::add(const Values& before, const Values& after, int samples) noexcept
+{
+    for (size_t i = 0; i < counts.size(); ++i)
+        counts[i].fetch_add(after[i] - before[i], std::memory_order_relaxed);
+
+    numSamples.fetch_add((uint64_t)samples, std::memory_order_relaxed);
+}
+
+void PerfCounters::Totals::reset() noexcept
+{
+    for (auto& count : counts)
+        count.store(0, std::memory_order_relaxed);
+
+    numSamples.store(0, std::memory_order_relaxed);
+}
+
+PerfCounters::Values PerfCounters::Totals::getCounts() const noexcept
+{
+    Values values {};
+
+    for (size_t i = 0; i < counts.size(); ++i)
+        values[i] = counts[i].load(std::memory_order_relaxed);
+
+    return values;
+}
+
+double PerfCounters::Totals::getPerSample(Counter counter) const noexcept
+{
+    const auto samples = getNumSamples();
+    return samples > 0 ? (double)counts[(size_t)counter].load(std::memory_order_relaxed) / (double)samples : 0.0;
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    Hardware performance counters for the calling thread (Linux only).
+
+    Opens cycles, instructions, L1 data cache misses, last level cache misses
+    and branch misses through perf_event_open. Any counter the kernel refuses
+    (containers, perf_event_paranoid, virtual machines without a PMU, other
+    platforms) is simply reported as unavailable.
+
+    Counters only see the thread that created them, so create the object on
+    the thread whose work you want to measure.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifndef FLANGER_ENABLE_PERF_COUNTERS
+ #define FLANGER_ENABLE_PERF_COUNTERS 0
+#endif
+
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        kCycles = 0,
+        kInstructions,
+        kL1DataMisses,
+        kLastLevelMisses,
+        kBranchMisses,
+        kNumCounters
+    };
+
+    using Values = std::array<uint64_t, kNumCounters>;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool isAvailable() const noexcept;
+    bool isAvailable(Counter counter) const noexcept { return fds[counter] >= 0; }
+
+    // Why counters are missing, e.g. "perf_event_open: Permission denied"; empty if all opened
+    const std::string& getUnavailableReason() const noexcept { return unavailableReason; }
+
+    // Running totals since construction, scaled up if the kernel had to
+    // multiplex the counters. Unavailable counters read as zero.
+    Values read() const noexcept;
+
+    static const char* getName(Counter counter) noexcept;
+
+    // Deltas accumulated across many measurements, readable from another thread
+    class Totals
+    {
+    public:
+        Totals() { reset(); }
+
+        void add(const Values& before, const Values& after, int numSamples) noexcept;
+        void reset() noexcept;
+
+        Values getCounts() const noexcept;
+        uint64_t getNumSamples() const noexcept { return numSamples.load(std::memory_order_relaxed); }
+
+        // Events per sample frame, or 0 before anything was measured
+        double getPerSample(Counter counter) const noexcept;
+
+    private:
+        std::array<std::atomic<uint64_t>, kNumCounters> counts;
+        std::atomic<uint64_t> numSamples;
+    };
+
+    // Adds the counter deltas over its lifetime to a Totals
+    class ScopedMeasurement
+    {
+    public:
+        ScopedMeasurement(const PerfCounters& countersToUse, Totals& totalsToUpdate, int numSamplesInBlock) noexcept
+            : counters(countersToUse), totals(totalsToUpdate), numSamples(numSamplesInBlock), before(counters.read())
+        {
+        }
+
+        ~ScopedMeasurement()
+        {
+            totals.add(before, counters.read(), numSamples);
+        }
+
+        ScopedMeasurement(const ScopedMeasurement&) = delete;
+        ScopedMeasurement& operator=(const ScopedMeasurement&) = delete;
+
+    private:
+        const PerfCounters& counters;
+        Totals& totals;
+        const int numSamples;
+        const Values before;
+    };
+
+private:
+    std::array<int, kNumCounters> fds;
+    std::string unavailableReason;
+};
@@ -13,13 +13,13 @@
 FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor& p)
     : AudioProcessorEditor(&p), audioProcessor(p)
 {
+    auto& parameters = audioProcessor.getValueTreeState();
+    const auto id = [](int index) { return FlangerAudioProcessor::getParameterID(index); };
 
     // LFO Sweep (Amplitude)
-    sweepSlider.setRange(0.0, 1.0);
-    //sweepSlider.setValue(0.7);
     sweepSlider.setSliderStyle(juce::Slider::Rotary);
     sweepSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 20);
-    sweepSlider.addListener(this);
+    sweepAttachment = std::make_unique<SliderAttachment>(parameters, id(FlangerAudioProcessor::kSweepParam), sweepSlider);
 
     sweepLabel.setText("Sweep", juce::dontSendNotification);
 
@@ -27,11 +27,9 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor&
     addAndMakeVisible(sweepLabel);
 
     // LFO Speed (Frequency)
-    speedSlider.setRange(0.0, 10.0);
-    //speedSlider.setValue(5.0);
     speedSlider.setSliderStyle(juce::Slider::Rotary);
     speedSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 20);
-    speedSlider.addListener(this);
+    speedAttachment = std::make_unique<SliderAttachment>(parameters, id(FlangerAudioProcessor::kFrequencyParam), speedSlider);
 
     speedLabel.setText("Speed", juce::dontSendNotification);
 
@@ -43,8 +41,7 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor&
     waveSelector.addItem("Tri", 2);
     waveSelector.addItem("Sqr", 3);
     waveSelector.addItem("Saw", 4);
-    waveSelector.onChange = [this] { audioProcessor.setParameter(5, waveSelector.getSelectedId()-1); };
-    waveSelector.setSelectedId(1);
+    waveAttachment = std::make_unique<ComboBoxAttachment>(parameters, id(FlangerAudioProcessor::kWaveParam), waveSelector);
 
     waveSelectorLabel.setText("LFO Type", juce::dontSendNotification);
 
@@ -55,20 +52,49 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor&
     interpolSelector.addItem("Lin", 1);
     interpolSelector.addItem("Sqr", 2);
     interpolSelector.addItem("Cub", 3);
-    interpolSelector.onChange = [this] { audioProcessor.setParameter(6, interpolSelector.getSelectedId()-1); };
-    interpolSelector.setSelectedId(1);
+    interpolSelector.addItem("Lagrange 3", 4);
+    interpolSelector.addItem("Lagrange 5", 5);
+    interpolSelector.addItem("Sinc 8", 6);
+    interpolSelector.addItem("Thiran", 7);
+    interpolAttachment = std::make_unique<ComboBoxAttachment>(parameters, id(FlangerAudioProcessor::kInterpolParam), interpolSelector);
+    interpolSelector.onChange = [this] { updateInterpolCost(); };
 
     interpolSelectorLabel.setText("Interpolation", juce::dontSendNotification);
 
+    // What the selected interpolator costs per sample and channel
+    interpolCostLabel.setFont(juce::Font(12.0f));
+    interpolCostLabel.setJustificationType(juce::Justification::topLeft);
+    updateInterpolCost();
+
     addAndMakeVisible(interpolSelector);
     addAndMakeVisible(interpolSelectorLabel);
+    addAndMakeVisible(interpolCostLabel);
+
+    // Oversampling tier and filter
+    oversamplingSelector.addItem("1x", 1);
+    oversamplingSelector.addItem("2x", 2);
+    oversamplingSelector.addItem("4x", 3);
+    oversamplingSelector.addItem("8x", 4);
+    oversamplingAttachment = std::make_unique<ComboBoxAttachment>(parameters, id(FlangerAudioProcessor::kOversamplingParam),
+                                                                  oversamplingSelector);
+    oversamplingSelector.onChange = [this] { updateOversamplingLatency(); };
+
+    oversamplingFilterSelector.addItem("IIR", 1);
+    oversamplingFilterSelector.addItem("FIR", 2);
+    oversamplingFilterAttachment = std::make_unique<ComboBoxAttachment>(parameters, id(FlangerAudioProcessor::kOversamplingFilterParam),
+                                                                        oversamplingFilterSelector);
+    oversamplingFilterSelector.onChange = [this] { updateOversamplingLatency(); };
+
+    updateOversamplingLatency();
+
+    addAndMakeVisible(oversamplingSelector);
+    addAndMakeVisible(oversamplingFilterSelector);
+    addAndMakeVisible(oversamplingLabel);
 
     // Delay
-    delaySlider.setRange(5.0, 25.0);
-    //delaySlider.setValue(15.0);
     delaySlider.setSliderStyle(juce::Slider::Rotary);
     delaySlider.setTextBoxStyle(juce::Slider::TextBoxAbove, false, 100, 20);
-    delaySlider.addListener(this);
+    delayAttachment = std::make_unique<SliderAttachment>(parameters, id(FlangerAudioProcessor::kDelayParam), delaySlider);
 
     delayLabel.setText("Delay/Amount", juce::dontSendNotification);
 
@@ -76,11 +102,9 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor&
     addAndMakeVisible(delayLabel);
 
     // Feedback gain
-    fbSlider.setRange(0.0, 0.99);
-    //fbSlider.setValue(0.80);
     fbSlider.setSliderStyle(juce::Slider::Rotary);
     fbSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 100, 20);
-    fbSlider.addListener(this);
+    fbAttachment = std::make_unique<SliderAttachment>(parameters, id(FlangerAudioProcessor::kFbParam), fbSlider);
 
     fbLabel.setText("Feedback", juce::dontSendNotification);
 
@@ -95,15 +119,47 @@ FlangerAudioProcessorEditor::FlangerAudioProcessorEditor(FlangerAudioProcessor&
 
     // WetDry Slider
     // wet = 0, dry = 1
-    wetDrySlider.setRange(0.0, 1.0);
-    //wetDrySlider.setValue(1.0);
     wetDrySlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 100, 20);
-    wetDrySlider.addListener(this);
+    wetDryAttachment = std::make_unique<SliderAttachment>(parameters, id(FlangerAudioProcessor::kWetParam), wetDrySlider);
     wetDryLabel.setText("Wet/Dry", juce::dontSendNotification);
 
     addAndMakeVisible(wetDrySlider);
     addAndMakeVisible(wetDryLabel);
 
+    // DSP load meter
+    loadLabel.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 13.0f, juce::Font::plain));
+    resetLoadButton.setButtonText("Reset");
+    resetLoadButton.onClick = [this] { audioProcessor.resetLoadStatistics(); };
+
+    addAndMakeVisible(loadLabel);
+    addAndMakeVisible(resetLoadButton);
+
+#if FLANGER_ENABLE_TRACE
+    // Trace builds only: dump the recorded trace markers for chrome://tracing
+    saveTraceButton.setButtonText("Save trace");
+    saveTraceButton.onClick = []
+    {
+        auto file = juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("FlangerTrace.json");
+        FlangerTrace::writeChromeTrace(file.getFullPathName().toStdString());
+    };
+
+    addAndMakeVisible(saveTraceButton);
+#endif
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    // Profiling builds only: hardware counters per sample frame, reset along with the load meter
+    perfLabel.setFont(loadLabel.getFont());
+    resetLoadButton.onClick = [this]
+    {
+        audioProcessor.resetLoadStatistics();
+        audioProcessor.resetPerfCounterTotals();
+    };
+
+    addAndMakeVisible(perfLabel);
+#endif
+
+    startTimerHz(4);
+
     // Window size
     setSize(800, 600);
 }
@@ -147,6 +203,11 @@ void FlangerAudioProcessorEditor::resized()
 
     interpolSelector.setBounds(680, 50, 100, 20);
     interpolSelectorLabel.setBounds(680, 20, 100, 20);
+    interpolCostLabel.setBounds(680, 75, 115, 45);
+
+    oversamplingLabel.setBounds(680, 120, 115, 20);
+    oversamplingSelector.setBounds(680, 140, 50, 20);
+    oversamplingFilterSelector.setBounds(735, 140, 55, 20);
 
     delaySlider.setBounds(20, 50, 100, 100);
     delayLabel.setBounds(20, 20, 100, 20);
@@ -158,12 +219,66 @@ void FlangerAudioProcessorEditor::resized()
 
     wetDrySlider.setBounds(150, 450, 500, 80);
     wetDryLabel.setBounds(330, 480, 300, 80);
+
+    loadLabel.setBounds(20, 565, 640, 20);
+    resetLoadButton.setBounds(680, 565, 100, 20);
+
+#if FLANGER_ENABLE_TRACE
+    saveTraceButton.setBounds(680, 540, 100, 20);
+#endif
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    perfLabel.setBounds(20, 540, 640, 20);
+#endif
+}
+
+void FlangerAudioProcessorEditor::updateInterpolCost()
+{
+    const auto& cost = FlangerKernel::getInterpolatorCost(interpolSelector.getSelectedId() - 1);
+
+    juce::String text = juce::String(cost.numTaps) + " taps, " + juce::String(cost.flops) + " flops";
+
+    if (cost.tableBytes > 0)
+        text << "\n" << juce::String((cost.tableBytes + 512) / 1024) << " KB table";
+
+    if (cost.recursive)
+        text << ", recursive";
+
+    interpolCostLabel.setText(text, juce::dontSendNotification);
+}
+
+void FlangerAudioProcessorEditor::updateOversamplingLatency()
+{
+    const int latency = audioProcessor.getOversamplingLatency();
+
+    oversamplingLabel.setText(latency > 0 ? "Oversampling (" + juce::String(latency) + " smp)" : juce::String("Oversampling"),
+                              juce::dontSendNotification);
 }
 
-void FlangerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
+void FlangerAudioProcessorEditor::timerCallback()
 {
-    if (slider == &sweepSlider) { audioProcessor.setParameter(1, sweepSlider.getValue()); }
-    else if (slider == &speedSlider) { audioProcessor.setParameter(4, speedSlider.getValue()); }
-    else if (slider == &delaySlider) { audioProcessor.setParameter(0, delaySlider.getValue()); }
-    else if (slider == &fbSlider) { audioProcessor.setParameter(3, fbSlider.getValue()); }
+    const auto stats = audioProcessor.getLoadStatistics();
+
+    loadLabel.setText("DSP load  avg " + juce::String(stats.averageLoad * 100.0, 1) + "%"
+                      + "  peak " + juce::String(stats.maxLoad * 100.0, 1) + "%"
+                      + "  p99 " + juce::String(stats.p99DurationMs, 3) + " ms"
+                      + "  max " + juce::String(stats.maxDurationMs, 3) + " ms"
+                      + "  overruns " + juce::String((juce::int64)stats.numOverruns)
+                      + "/" + juce::String((juce::int64)stats.numBlocks),
+                      juce::dontSendNotification);
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    const auto& perf = audioProcessor.getPerfCounterTotals();
+    const double cycles = perf.getPerSample(PerfCounters::kCycles);
+
+    if (perf.getNumSamples() == 0 || cycles <= 0.0)
+        perfLabel.setText("Counters  unavailable", juce::dontSendNotification);
+    else
+        perfLabel.setText("Per sample  cycles " + juce::String(cycles, 1)
+                          + "  IPC " + juce::String(perf.getPerSample(PerfCounters::kInstructions) / cycles, 2)
+                          + "  L1d miss " + juce::String(perf.getPerSample(PerfCounters::kL1DataMisses), 3)
+                          + "  LLC miss " + juce::String(perf.getPerSample(PerfCounters::kLastLevelMisses), 3)
+                          + "  br miss " + juce::String(perf.getPerSample(PerfCounters::kBranchMisses), 3),
+                          juce::dontSendNotification);
+#endif
 }
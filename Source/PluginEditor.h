@@ -10,11 +10,12 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "FlangerTrace.h"
 
 //==============================================================================
 /**
 */
-class FlangerAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Slider::Listener
+class FlangerAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     FlangerAudioProcessorEditor(FlangerAudioProcessor&);
@@ -46,13 +47,47 @@ private:
 
     juce::ComboBox interpolSelector;
     juce::Label interpolSelectorLabel;
+    juce::Label interpolCostLabel;
+
+    juce::ComboBox oversamplingSelector;
+    juce::ComboBox oversamplingFilterSelector;
+    juce::Label oversamplingLabel;
 
     juce::ToggleButton phaseSwitch;
 
     juce::Slider wetDrySlider;
     juce::Label wetDryLabel;
 
-    void sliderValueChanged(juce::Slider* slider) override;
+    // DSP load readout, refreshed from the processor's load meter
+    juce::Label loadLabel;
+    juce::TextButton resetLoadButton;
+
+#if FLANGER_ENABLE_TRACE
+    juce::TextButton saveTraceButton;
+#endif
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    juce::Label perfLabel;
+#endif
+
+    // Keep the controls and the processor's parameters in step; declared after the
+    // controls so they're destroyed first
+    using SliderAttachment = juce::AudioProcessorValueTreeState::SliderAttachment;
+    using ComboBoxAttachment = juce::AudioProcessorValueTreeState::ComboBoxAttachment;
+
+    std::unique_ptr<SliderAttachment> sweepAttachment;
+    std::unique_ptr<SliderAttachment> speedAttachment;
+    std::unique_ptr<SliderAttachment> delayAttachment;
+    std::unique_ptr<SliderAttachment> fbAttachment;
+    std::unique_ptr<SliderAttachment> wetDryAttachment;
+    std::unique_ptr<ComboBoxAttachment> waveAttachment;
+    std::unique_ptr<ComboBoxAttachment> interpolAttachment;
+    std::unique_ptr<ComboBoxAttachment> oversamplingAttachment;
+    std::unique_ptr<ComboBoxAttachment> oversamplingFilterAttachment;
+
+    void timerCallback() override;
+    void updateInterpolCost();
+    void updateOversamplingLatency();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FlangerAudioProcessorEditor)
 };
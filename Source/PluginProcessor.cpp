@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "FlangerTrace.h"
 
 //==============================================================================
 FlangerAudioProcessor::FlangerAudioProcessor()
@@ -19,18 +20,35 @@ FlangerAudioProcessor::FlangerAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       )
+                       ),
 #endif
+      parameters(*this, nullptr, "Flanger", createParameterLayout())
 {
     // Read and Write pointers initialized
     delayBufferRead = 1;
     delayBufferWrite = 0;
 
+    // Start the store off at the defaults, then keep it in step with the parameters
+    for (int index = 0; index < kNumParameters; ++index)
+    {
+        parameterObjects[index] = parameters.getParameter(getParameterID(index));
+        parameterStore.set(index, parameters.getRawParameterValue(getParameterID(index))->load());
+        parameters.addParameterListener(getParameterID(index), this);
+    }
+
+    readParameters();
+
+    // Often enough for a host to catch up with an oversampling change within a few blocks
+    startTimerHz(10);
 }
 
 
 FlangerAudioProcessor::~FlangerAudioProcessor()
 {
+    stopTimer();
+
+    for (int index = 0; index < kNumParameters; ++index)
+        parameters.removeParameterListener(getParameterID(index), this);
 }
 
 //==============================================================================
@@ -44,74 +62,146 @@ int FlangerAudioProcessor::getNumParameters()
     return kNumParameters;
 }
 
-float FlangerAudioProcessor::getParameter(int index)
+juce::String FlangerAudioProcessor::getParameterID(int index)
 {
     switch (index)
     {
-    case kDelayParam: return delay;
-    case kSweepParam: return sweep;
-    case kDepthParam: return g;
-    case kWetParam: return wet;
-    case kWaveParam: return wave;
-    case kInterpolParam: return interpol;
-    case kFbParam: return fb;
-    case kFrequencyParam: return speed;
-    case kStereoParam: return stereo;
-    default:return 0.0f;
+    case kDelayParam: return "delay";
+    case kSweepParam: return "sweep";
+    case kDepthParam: return "depth";
+    case kWetParam: return "wet";
+    case kWaveParam: return "waveform";
+    case kInterpolParam: return "interpolation";
+    case kFbParam: return "feedback";
+    case kFrequencyParam: return "frequency";
+    case kStereoParam: return "stereo";
+    case kOversamplingParam: return "oversampling";
+    case kOversamplingFilterParam: return "oversamplingFilter";
+    default: break;
     }
+
+    return juce::String();
 }
 
-// Setters functions implementation: (DA COLLEGARE CON EDITOR)
-void FlangerAudioProcessor::setParameter(int index, float newValue) {
-    switch (index)
+juce::AudioProcessorValueTreeState::ParameterLayout FlangerAudioProcessor::createParameterLayout()
+{
+    // In Parameters order, so the host lists them the way the enum does
+    std::vector<std::unique_ptr<juce::RangedAudioParameter>> layout;
+
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kDelayParam), "delay",
+                                                                 juce::NormalisableRange<float>(5.0f, 25.0f), 15.0f, "ms"));
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kSweepParam), "sweep width",
+                                                                 juce::NormalisableRange<float>(0.0f, 1.0f), 0.7f, "ms"));
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kDepthParam), "depth",
+                                                                 juce::NormalisableRange<float>(0.0f, 1.0f), 1.0f));
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kWetParam), "wet",
+                                                                 juce::NormalisableRange<float>(0.0f, 1.0f), 1.0f));
+    layout.push_back(std::make_unique<juce::AudioParameterChoice>(getParameterID(kWaveParam), "waveform",
+                                                                  juce::StringArray { "Sin", "Tri", "Sqr", "Saw" }, kSineWave));
+    layout.push_back(std::make_unique<juce::AudioParameterChoice>(getParameterID(kInterpolParam), "interpolation",
+                                                                  juce::StringArray { "Lin", "Sqr", "Cub", "Lagrange 3",
+                                                                                      "Lagrange 5", "Sinc 8", "Thiran" },
+                                                                  kLinear));
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kFbParam), "feedback",
+                                                                 juce::NormalisableRange<float>(0.0f, 0.99f), 0.8f));
+    layout.push_back(std::make_unique<juce::AudioParameterFloat>(getParameterID(kFrequencyParam), "frequency",
+                                                                 juce::NormalisableRange<float>(0.0f, 10.0f), 5.0f, "Hz"));
+    layout.push_back(std::make_unique<juce::AudioParameterBool>(getParameterID(kStereoParam), "stereo", false));
+    layout.push_back(std::make_unique<juce::AudioParameterChoice>(getParameterID(kOversamplingParam), "oversampling",
+                                                                  juce::StringArray { "1x", "2x", "4x", "8x" }, kOversampling1x));
+    layout.push_back(std::make_unique<juce::AudioParameterChoice>(getParameterID(kOversamplingFilterParam), "oversampling filter",
+                                                                  juce::StringArray { "IIR", "FIR" }, kPolyphaseIIR));
+
+    jassert((int)layout.size() == kNumParameters);
+    return { layout.begin(), layout.end() };
+}
+
+float FlangerAudioProcessor::getParameter(int index)
+{
+    return index >= 0 && index < kNumParameters ? parameterStore.get(index) : 0.0f;
+}
+
+void FlangerAudioProcessor::setParameter(int index, float newValue)
+{
+    if (index < 0 || index >= kNumParameters)
+        return;
+
+    if (auto* parameter = parameterObjects[index])
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(newValue));
+}
+
+void FlangerAudioProcessor::automateParameter(int index, float newValue) noexcept
+{
+    if (index < 0 || index >= kNumParameters)
+        return;
+
+    // Limited and snapped to the parameter's range, as setValueNotifyingHost() would
+    if (auto* parameter = parameterObjects[index])
     {
-    case kDelayParam:
-        delay = newValue;
-        break;
-    case kSweepParam:
-        sweep = newValue;
-        break;
-    case kDepthParam:
-        g = newValue;
-        break;
-    case kFbParam:
-        fb = newValue;
-        break;
-    case kFrequencyParam:
-        speed = newValue;
-        break;
-    case kWaveParam:
-        wave = (int)newValue;
-        break;
-    case kInterpolParam:
-        interpol = (int)newValue;
-        break;
-    case kStereoParam:
-        stereo = (int)newValue;
-        break;
-    case kWetParam:
-        wet = (int)newValue;
-    default:
-        break;
+        parameterStore.set(index, parameter->convertFrom0to1(parameter->convertTo0to1(newValue)));
+        pendingNotifications.fetch_or(1u << index, std::memory_order_release);
     }
 }
 
+void FlangerAudioProcessor::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    for (int index = 0; index < kNumParameters; ++index)
+    {
+        if (parameterObjects[index] != nullptr && parameterID == parameterObjects[index]->paramID)
+        {
+            if (index != notifyingIndex.load(std::memory_order_relaxed))
+                parameterStore.set(index, newValue);
 
-const juce::String FlangerAudioProcessor::getParameterName(int index) {
-    switch (index)
+            return;
+        }
+    }
+}
+
+void FlangerAudioProcessor::timerCallback()
+{
+    // The store already holds the automated values, so they're passed on from there
+    auto pending = pendingNotifications.exchange(0, std::memory_order_acquire);
+
+    for (int index = 0; pending != 0; ++index, pending >>= 1)
     {
-    case kDelayParam: return "delay";
-    case kSweepParam: return "sweep width";
-    case kDepthParam: return "depth";
-    case kFbParam: return "feedback";
-    case kFrequencyParam: return "frequency";
-    case kWaveParam: return "waveform";
-    case kInterpolParam: return "interpolation";
-    case kStereoParam: return "stereo";
-    case kWetParam: return "wet";
-    default: break;
+        if ((pending & 1u) == 0)
+            continue;
+
+        if (auto* parameter = parameterObjects[index])
+        {
+            notifyingIndex.store(index, std::memory_order_relaxed);
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(parameterStore.get(index)));
+            notifyingIndex.store(-1, std::memory_order_relaxed);
+        }
     }
 
+    // Does nothing unless the latency has changed
+    setLatencySamples(getOversamplingLatency());
+}
+
+void FlangerAudioProcessor::readParameters() noexcept
+{
+    // The version first: anything that changes after it is read gets picked up next block
+    parameterVersion = parameterStore.getVersion();
+
+    delay = parameterStore.get(kDelayParam);
+    sweep = parameterStore.get(kSweepParam);
+    g = parameterStore.get(kDepthParam);
+    wet = parameterStore.get(kWetParam);
+    wave = juce::roundToInt(parameterStore.get(kWaveParam));
+    interpol = juce::roundToInt(parameterStore.get(kInterpolParam));
+    fb = parameterStore.get(kFbParam);
+    speed = parameterStore.get(kFrequencyParam);
+    stereo = juce::roundToInt(parameterStore.get(kStereoParam));
+    oversampling = juce::jlimit(0, kNumOversamplingTiers - 1, juce::roundToInt(parameterStore.get(kOversamplingParam)));
+    oversamplingFilter = juce::jlimit(0, kNumOversamplingFilters - 1, juce::roundToInt(parameterStore.get(kOversamplingFilterParam)));
+}
+
+
+const juce::String FlangerAudioProcessor::getParameterName(int index) {
+    if (auto* parameter = parameters.getParameter(getParameterID(index)))
+        return parameter->getName(64);
+
     return juce::String();
 }
 
@@ -167,7 +257,18 @@ bool FlangerAudioProcessor::isMidiEffect() const
 
 double FlangerAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // From the store, as hosts ask from whichever thread they like. The longest delay
+    // the LFO reaches, once, then once more for each trip round the feedback loop it
+    // takes a full scale signal to fall below the silence threshold.
+    const double longestDelaySeconds = (parameterStore.get(kDelayParam) + juce::jmax(0.0f, parameterStore.get(kSweepParam))) * 0.001;
+    const double feedback = std::abs(parameterStore.get(kFbParam));
+
+    if (feedback <= 0.0)
+        return longestDelaySeconds;
+
+    const double loops = std::ceil(std::log((double)kSilenceThreshold) / std::log(juce::jmin(feedback, 0.999)));
+
+    return longestDelaySeconds * (1.0 + loops);
 }
 
 int FlangerAudioProcessor::getNumPrograms()
@@ -197,24 +298,86 @@ void FlangerAudioProcessor::changeProgramName(int index, const juce::String& new
 //==============================================================================
 void FlangerAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    FLANGER_TRACE_SCOPE("prepareToPlay");
+
     // Use this method as the place to do any pre-playback initialisation that you need..
+    readParameters();
 
-    // 10
-    // Retrieve the delay buffer length from the sample rate
-    delayBufferLength = (int)(2 * sampleRate);
-    // non-zero length check
-    if (delayBufferLength < 1) {
-        delayBufferLength = 1;
+    const int numLanes = FlangerKernel::getNumLanes(getTotalNumInputChannels());
+
+    // The rate the delay line ran at until now, for resampling what it holds
+    const double previousRate = preparedSampleRate * (1 << activeOversampling);
+
+    idle = false;
+    preparedSampleRate = sampleRate;
+    maxBlockSize = juce::jmax(1, samplesPerBlock);
+    longestDelayMs = parameters.getParameterRange(getParameterID(kDelayParam)).end
+                     + juce::jmax(0.0f, parameters.getParameterRange(getParameterID(kSweepParam)).end);
+
+    // Nothing on the audio thread works out anything from the sample rate again
+    const double inverseSampleRate = 1.0 / sampleRate;
+    const float samplesPerMs = (float)(sampleRate * 0.001);
+
+    for (int tier = 0; tier < kNumOversamplingTiers; ++tier)
+    {
+        const int factor = 1 << tier;
+        auto& rate = rateConstants[tier];
+
+        rate.inverseRate = inverseSampleRate / factor;
+        rate.samplesPerMs = samplesPerMs * (float)factor;
+        rate.rampLength = juce::roundToInt(kSmoothingMs * samplesPerMs * factor);
+        rate.delayLineFrames = getDelayLineFrames(tier);
+    }
+
+    activeOversampling = oversampling;
+    activeOversamplingFilter = oversamplingFilter;
+
+    // The delay line runs at the oversampled rate, so its blocks are up to 8 times longer
+    modulation.prepare(maxBlockSize * kMaxOversamplingFactor);
+
+    // The host picks the precision before calling this, so only that one holds any audio
+    if (isUsingDoublePrecision())
+    {
+        prepareEngine<double>(numLanes, previousRate);
+        floatEngine = Engine<float>();
+    }
+    else
+    {
+        prepareEngine<float>(numLanes, previousRate);
+        doubleEngine = Engine<double>();
+    }
+
+    // The latency of every tier and filter, from the oversamplers just prepared
+    const auto getLatency = [](const auto* oversampler)
+    {
+        // The oversamplers are built to round their latency to whole samples
+        return oversampler != nullptr ? juce::roundToInt(oversampler->getLatencyInSamples()) : 0;
+    };
+
+    for (int tier = 0; tier < kNumOversamplingTiers; ++tier)
+    {
+        for (int filter = 0; filter < kNumOversamplingFilters; ++filter)
+        {
+            const int latency = isUsingDoublePrecision() ? getLatency(doubleEngine.getOversampler(tier, filter))
+                                                         : getLatency(floatEngine.getOversampler(tier, filter));
+            oversamplingLatencies[tier][filter].store(latency, std::memory_order_relaxed);
+        }
     }
-    // Allocate and initialize the delay buffer
-    delayBuffer.setSize(2, delayBufferLength);
-    delayBuffer.clear();
 
-    lfoPhase = 0.0;
-    inverseSampleRate = 1.0 / 44100.0;
-    
-    wave = 0;
-    interpol = 0;
+    setLatencySamples(getOversamplingLatency());
+
+    // Everything processDelayLine takes from scratch for the longest block it runs
+    const auto maxFrames = (size_t)modulation.getMaxBlockSize();
+    const auto spareFrames = (size_t)(numLanes - 1) * maxFrames;
+    const size_t spareLanesSize = isUsingDoublePrecision() ? FlangerScratchArena::getAllocationSize<double>(spareFrames)
+                                                           : FlangerScratchArena::getAllocationSize<float>(spareFrames);
+
+    scratch.prepare(FlangerModulation::getScratchSize(modulation.getMaxBlockSize())
+                    + FlangerScratchArena::getAllocationSize<float>(kNumSmoothingRamps * maxFrames)
+                    + FlangerScratchArena::getAllocationSize<FlangerLfo::Phase>(maxFrames)
+                    + spareLanesSize);
+    resetSmoothers();
+    loadMeter.prepare(sampleRate);
 }
 
 void FlangerAudioProcessor::releaseResources()
@@ -223,6 +386,17 @@ void FlangerAudioProcessor::releaseResources()
     // spare memory, etc.
 }
 
+void FlangerAudioProcessor::reset()
+{
+    if (isUsingDoublePrecision())
+        clearEngine<double>();
+    else
+        clearEngine<float>();
+
+    resetSmoothers();
+    idle = false;
+}
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool FlangerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
@@ -249,35 +423,243 @@ bool FlangerAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) c
 }
 #endif
 
-// LFO DA IMPLEMENTARE
-float FlangerAudioProcessor::lfo(int ph, int waveform) {
-    switch (waveform)
+//==============================================================================
+template <>
+FlangerAudioProcessor::Engine<float>& FlangerAudioProcessor::getEngine<float>() noexcept
+{
+    return floatEngine;
+}
+
+template <>
+FlangerAudioProcessor::Engine<double>& FlangerAudioProcessor::getEngine<double>() noexcept
+{
+    return doubleEngine;
+}
+
+namespace
+{
+    // Resamples numFrames interleaved frames of numChannels samples, step of them to each
+    // new frame, to numResampled frames with Catmull-Rom interpolation. The new frames end
+    // where the old ones would have carried on, one new frame before the next write, as if
+    // they had been written at the new rate all along; the last of them may sit up to a
+    // frame past the newest old one. There's no anti-aliasing filter, but this only runs
+    // once, on a few tens of milliseconds of audio, when the rate or the tier changes.
+    template <typename SampleType>
+    void resampleFrames(const SampleType* frames, int numFrames, SampleType* resampled, int numResampled,
+                        int numChannels, double step) noexcept
     {
-    case kTrWave:
-        if (ph < 0.25f)
-            return 0.5f + 2.0f * ph;
-        else if (ph < 0.75f)
-            return 1.0f - 2.0f * (ph - 0.25f);
-        else
-            return 2.0f * (ph - 0.75f);
-    case kSqWave:
-        if (ph < 0.5f)
-            return 1.0f;
-        else
-            return 0.0f;
-    case kSawWave:
-        if (ph < 0.5f)
-            return 0.5f + ph;
-        else
-            return ph - 0.5f;
-    case kSineWave:
-    default:
-        return 0.5f + 0.5f * sinf(2.0 * 3.14 * ph);
+        // One frame beyond either end, carry on the slope of the last two
+        const auto getTap = [=](int frame, int channel)
+        {
+            if (numFrames < 2)
+                return frames[channel];
+
+            if (frame < 0)
+                return (SampleType)2 * frames[channel] - frames[numChannels + channel];
+
+            if (frame >= numFrames)
+                return (SampleType)2 * frames[(numFrames - 1) * numChannels + channel]
+                       - frames[(numFrames - 2) * numChannels + channel];
+
+            return frames[frame * numChannels + channel];
+        };
+
+        for (int i = 0; i < numResampled; ++i)
+        {
+            const double position = juce::jmax(0.0, numFrames - (numResampled - i) * step);
+            const int whole = (int)position;
+            const auto fraction = (SampleType)(position - whole);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                const SampleType x0 = getTap(whole - 1, channel);
+                const SampleType x1 = getTap(whole, channel);
+                const SampleType x2 = getTap(whole + 1, channel);
+                const SampleType x3 = getTap(whole + 2, channel);
+
+                resampled[i * numChannels + channel] = x1 + (SampleType)0.5 * fraction
+                    * (x2 - x0 + fraction * ((SampleType)2 * x0 - (SampleType)5 * x1 + (SampleType)4 * x2 - x3
+                                             + fraction * ((SampleType)3 * (x1 - x2) + x3 - x0)));
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void FlangerAudioProcessor::prepareEngine(int numLanes, double previousRate)
+{
+    auto& engine = getEngine<SampleType>();
+
+    // Take what the line holds before preparing clears it, oldest frame first. prepareToPlay
+    // runs off the audio thread, so growing the history buffers is fine. After a precision
+    // switch this engine is empty, and writtenFrames belongs to the other one.
+    int numFrames = 0;
+
+    if (previousRate > 0.0 && engine.delayLine.getLength() > 0 && engine.delayLine.getNumChannels() == numLanes)
+    {
+        numFrames = juce::jmin(writtenFrames, engine.delayLine.getLength());
+
+        if (engine.history.size() < (size_t)(numFrames * numLanes))
+            engine.history.resize((size_t)(numFrames * numLanes));
+
+        engine.delayLine.read((delayBufferWrite - numFrames) & engine.delayLine.getMask(), engine.history.data(), numFrames);
+    }
+
+    // The line has room for the highest tier, so switching tiers never allocates, but the
+    // ring only covers what the current one needs
+    engine.prepare(numLanes, rateConstants[kNumOversamplingTiers - 1].delayLineFrames, maxBlockSize);
+    engine.delayLine.setLength(rateConstants[activeOversampling].delayLineFrames);
+
+    // A whole ring's worth at the highest tier, so a tier switch can carry the audio over
+    // on the audio thread too
+    const auto historySize = (size_t)(engine.delayLine.getCapacity() * numLanes);
+
+    if (engine.history.size() < historySize)
+        engine.history.resize(historySize);
+
+    if (engine.resampledHistory.size() < historySize)
+        engine.resampledHistory.resize(historySize);
+
+    restoreHistory<SampleType>(numFrames, previousRate, activeOversampling);
+}
+
+template <typename SampleType>
+void FlangerAudioProcessor::restoreHistory(int numFrames, double previousRate, int tier) noexcept
+{
+    auto& engine = getEngine<SampleType>();
+    const int numLanes = engine.delayLine.getNumChannels();
+    const double newRate = preparedSampleRate * (1 << tier);
+
+    // No read reaches further back than this, so neither the history nor the clearing
+    // need to go any further
+    const int reachableFrames = juce::jmin(rateConstants[tier].delayLineFrames, engine.delayLine.getLength());
+
+    delayBufferWrite = 0;
+    writtenFrames = 0;
+
+    // Put it back just behind the write pointer, at the new rate, dropping the oldest
+    // frames if they're out of reach now
+    int numKept = 0;
+
+    if (numFrames > 0)
+    {
+        const SampleType* frames = engine.history.data();
+
+        if (newRate != previousRate)
+        {
+            // Only resample the frames that are still in reach afterwards, which also keeps
+            // the result within resampledHistory
+            const int numUsed = juce::jlimit(1, numFrames, (int)std::ceil(reachableFrames * previousRate / newRate));
+            const int numResampled = juce::jmax(1, juce::roundToInt(numUsed * newRate / previousRate));
+
+            resampleFrames(frames + (numFrames - numUsed) * numLanes, numUsed, engine.resampledHistory.data(),
+                           numResampled, numLanes, previousRate / newRate);
+
+            frames = engine.resampledHistory.data();
+            numFrames = numResampled;
+        }
+
+        numKept = juce::jmin(numFrames, reachableFrames);
+        engine.delayLine.write(-numKept & engine.delayLine.getMask(), frames + (numFrames - numKept) * numLanes, numKept);
+    }
+
+    // Whatever the ring held there before, from another tier or another rate, mustn't be heard
+    engine.delayLine.clear(-numKept & engine.delayLine.getMask(), reachableFrames - numKept);
+    writtenFrames = numKept;
+}
+
+template <typename SampleType>
+void FlangerAudioProcessor::Engine<SampleType>::prepare(int numLanes, int maxDelayFrames, int maxBlockSize)
+{
+    // 10
+    // The delay line rounds this up to a power of two, so the read and write pointers wrap
+    // with a mask, and holds the channels interleaved so the kernel can run them in the
+    // lanes of a vector. Preparing again for the same or fewer frames reuses the memory.
+    delayLine.prepare(maxDelayFrames, numLanes);
+
+    kernelState = {};
+
+    // Every oversampling tier and filter is built up front for the host's block size
+    using Oversampling = juce::dsp::Oversampling<SampleType>;
+
+    if (numLanes == oversamplerLanes && maxBlockSize <= oversamplerBlockSize)
+    {
+        for (auto& row : oversamplers)
+            for (auto& oversampler : row)
+                oversampler->reset();
+
+        return;
     }
+
+    oversamplerLanes = numLanes;
+    oversamplerBlockSize = maxBlockSize;
+
+    for (int tier = kOversampling2x; tier < kNumOversamplingTiers; ++tier)
+    {
+        for (int filter = 0; filter < kNumOversamplingFilters; ++filter)
+        {
+            auto& oversampler = oversamplers[tier - 1][filter];
+            oversampler = std::make_unique<Oversampling>((size_t)numLanes, (size_t)tier,
+                                                         filter == kEquirippleFIR ? Oversampling::filterHalfBandFIREquiripple
+                                                                                  : Oversampling::filterHalfBandPolyphaseIIR,
+                                                         true, true);
+            oversampler->initProcessing((size_t)maxBlockSize);
+        }
+    }
+}
+
+template <typename SampleType>
+juce::dsp::Oversampling<SampleType>* FlangerAudioProcessor::Engine<SampleType>::getOversampler(int tier, int filter) const noexcept
+{
+    if (tier <= kOversampling1x || tier >= kNumOversamplingTiers || filter < 0 || filter >= kNumOversamplingFilters)
+        return nullptr;
+
+    return oversamplers[tier - 1][filter].get();
 }
 
-void FlangerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+namespace
 {
+    // Whether the first numChannels channels of buffer are all within threshold of zero,
+    // from their vectorised minimum and maximum
+    template <typename SampleType>
+    bool isSilent(const juce::AudioBuffer<SampleType>& buffer, int numChannels, SampleType threshold) noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(buffer.getReadPointer(channel), buffer.getNumSamples());
+
+            if (range.getStart() < -threshold || range.getEnd() > threshold)
+                return false;
+        }
+
+        return true;
+    }
+}
+
+void FlangerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processSamples(buffer);
+}
+
+void FlangerAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    processSamples(buffer);
+}
+
+template <typename SampleType>
+void FlangerAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
+{
+    FLANGER_TRACE_SCOPE("processBlock");
+    DspLoadMeter::ScopedTimer loadTimer(loadMeter, buffer.getNumSamples());
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    // Opening the counters allocates and makes system calls, which is fine for a profiling build only
+    if (perfCounters == nullptr)
+        perfCounters = std::make_unique<PerfCounters>();
+
+    PerfCounters::ScopedMeasurement perfMeasurement(*perfCounters, perfTotals, buffer.getNumSamples());
+#endif
+
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -301,154 +683,350 @@ void FlangerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce:
     // Helpful information about this block of samples:
 
     const int numInputChannels = getNumInputChannels();     // How many input channels for our effect?
-    const int numOutputChannels = getNumOutputChannels();   // How many output channels for our effect?
     const int numSamples = buffer.getNumSamples();          // How many samples in the buffer for this block?
 
-    int channel, dpw; // dpr = delay read pointer; dpw = delay write pointer
-    float dpr, currentDelay, ph;
-    float channel0EndPhase = lfoPhase;
+    auto& engine = getEngine<SampleType>();
+
+    // prepareToPlay sizes the scratch buffers, and the delay line for the precision the host
+    // said it would use; until then the input passes through unchanged
+    if (modulation.getMaxBlockSize() == 0 || engine.delayLine.getLength() == 0)
+        return;
+
+    // One snapshot of the parameters per block, and only after something has changed
+    if (parameterStore.getVersion() != parameterVersion)
+        readParameters();
+
+    const int numLanes = engine.delayLine.getNumChannels();
+    const int numChannels = juce::jmin(numInputChannels, numLanes);
+
+    if (numChannels == 0)
+        return;
+
+    // Switching tiers changes the rate the delay line runs at, so what it holds is resampled
+    // to the new rate, the way a reprepare does, into the ring resized within what
+    // prepareToPlay allocated. Only what a read can reach is carried over and cleared, so
+    // the block that switches does work in proportion to the longest delay at the two
+    // tiers' rates, not to the rings. The new oversampler starts from silence, and the
+    // output shifts by the difference between the two tiers' latencies.
+    if (oversampling != activeOversampling || oversamplingFilter != activeOversamplingFilter)
+    {
+        if (auto* oversampler = engine.getOversampler(oversampling, oversamplingFilter))
+            oversampler->reset();
+
+        if (oversampling != activeOversampling)
+        {
+            const int numFrames = juce::jmin(writtenFrames, rateConstants[activeOversampling].delayLineFrames,
+                                             engine.delayLine.getLength());
+
+            jassert(engine.history.size() >= (size_t)(numFrames * numLanes));
+            engine.delayLine.read((delayBufferWrite - numFrames) & engine.delayLine.getMask(), engine.history.data(), numFrames);
+            engine.delayLine.setLength(rateConstants[oversampling].delayLineFrames);
+            restoreHistory<SampleType>(numFrames, preparedSampleRate * (1 << activeOversampling), oversampling);
+
+            engine.kernelState = {};
+            resetSmoothers();
+        }
+
+        activeOversampling = oversampling;
+        activeOversamplingFilter = oversamplingFilter;
+    }
+
+    auto* oversampler = engine.getOversampler(activeOversampling, activeOversamplingFilter);
+    const int oversamplingFactor = 1 << activeOversampling;
+    const auto& rate = rateConstants[activeOversampling];
+
+    // Parameters are read once per block, so every stage and channel sees the same values.
+    // The continuous ones glide to them from wherever they were, at the oversampled rate
+    // the modulation runs at; the smoothers ignore targets they're already heading for.
+    delaySmoother.setTarget(delay, rate.rampLength);
+    sweepSmoother.setTarget(sweep, rate.rampLength);
+    depthSmoother.setTarget(g, rate.rampLength);
+    feedbackSmoother.setTarget(fb, rate.rampLength);
+    speedSmoother.setTarget(speed, rate.rampLength);
+
+    // While idle, the delay line is empty and the input silent, so the output would be the
+    // input: leave it, and only move the LFO and write pointer on as processing would have.
+    // The parameters jump to their targets, as there's nothing to hear them glide.
+    const bool inputSilent = isSilent(buffer, numChannels, (SampleType)kSilenceThreshold);
+
+    if (idle && inputSilent)
+    {
+        resetSmoothers();
+
+        const int numFrames = numSamples * oversamplingFactor;
+        const auto phaseIncrement = FlangerLfo::getPhaseIncrement(speed, rate.inverseRate);
+
+        lfoPhase += (FlangerLfo::Phase)numFrames * phaseIncrement;
+        delayBufferWrite = (delayBufferWrite + numFrames) & engine.delayLine.getMask();
+        return;
+    }
+
+    idle = false;
+
+    FlangerModulation::Settings settings;
+    settings.samplesPerMs = rate.samplesPerMs;
+    settings.lfoTable = FlangerLfo::getTable(wave);
+    settings.delayMask = engine.delayLine.getMask();
+
+    // For stereo flanging, keep the channels 90 degrees out of phase with each other
+    const bool quadrature = stereo != 0 && numChannels > 1;
 
-    // Go through each channel of audio that's passed in. In this example we apply identical
-    // effects to each channel, regardless of how many input channels there are. For some effects, like
-    // a stereo chorus or panner, you might do something different for each channel.
+    // The kernel is specialised for every setting that can't change within the block, so
+    // it is picked once per block instead of branching inside the sample loops: from these,
+    // and from whether the gains are moving, in processDelayLine
+    static_assert(kLinear == FlangerKernel::kLinear && kQuadratic == FlangerKernel::kQuadratic
+                  && kCubic == FlangerKernel::kCubic && kLagrange3 == FlangerKernel::kLagrange3
+                  && kLagrange5 == FlangerKernel::kLagrange5 && kSinc == FlangerKernel::kSinc
+                  && kThiran == FlangerKernel::kThiran, "interpolation modes index the kernel table");
 
-    for (channel = 0; channel < numInputChannels; ++channel)
+    FlangerKernel::KernelSettings kernelSettings;
+    kernelSettings.interpolation = interpol;
+    kernelSettings.numLanes = numLanes;
+    kernelSettings.linked = !quadrature;
+
+    const double inverseRate = rate.inverseRate;
+
+    // Blocks longer than the one announced in prepareToPlay are processed in pieces
+    for (int start = 0; start < numSamples;)
     {
-        // channelData is an array of length numSamples which contains the audio for one channel
-        float* channelOutData = buffer.getWritePointer(channel);
-
-        // delayData is the circular buffer for implementing delay on this channel
-        float* delayData = delayBuffer.getWritePointer(juce::jmin(channel, delayBuffer.getNumChannels() - 1));
-
-        const float* channelInData = buffer.getReadPointer(channel);
-        // Make a temporary copy of any state variables declared in PluginProcessor.h which need to be
-        // maintained between calls to processBlock(). Each channel needs to be processed identically
-        // which means that the activity of processing one channel can't affect the state variable for
-        // the next channel.
-        
-        dpw = delayBufferWrite;
-        dpr = delayBufferRead;
-        ph = lfoPhase;
-        float speedP = speed;
-        float delayP = delay;
-        float wetP = wet;
-        float fbP = fb;
-        float sweepP = sweep;
-        float gP = g;
-        float timeP = time;
-        int polarityP = polarity;
-        int interpolP = interpol;
-        int waveP = wave;
-        int stereoP = stereo;
-
-        // For stereo flanging, keep the channels 90 degrees out of phase with each other
-        if (stereoP != 0 && channel != 0)
-            ph = fmodf(ph + 0.25, 1.0);
-
-        for (int i = 0; i < numSamples; ++i) {
-
-            const float in = channelInData[i];
-            float interpolatedSample = 0.0;
-
-            // Recalculate the read pointer position with respect to the write pointer. A more efficient
-            // implementation might increment the read pointer based on the derivative of the LFO without
-            // running the whole equation again, but this format makes the operation clearer.
-
-            //FUNZIONE LFO DA IMPLEMENTARE, wave parametro della funzione (mancante)
-            currentDelay = delayP + sweepP * lfo(ph, waveP);
-            dpr = fmodf((float)dpw - (float)(currentDelay * getSampleRate()) + (float)delayBufferLength,
-                (float)delayBufferLength);
-
-            // In this example, the output is the input plus the contents of the delay buffer (weighted by delayMix)
-            // The last term implements a tremolo (variable amplitude) on the whole thing.
-
-            if (interpolP == kLinear) {
-
-                // Find the fraction by which the read pointer sits between two
-                // samples and use this to adjust weights of the samples
-                float fraction = dpr - floorf(dpr);
-                int previousSample = (int)floorf(dpr);
-                int nextSample = (previousSample + 1) % delayBufferLength;
-                interpolatedSample = fraction * delayData[nextSample]
-                    + (1.0f - fraction) * delayData[previousSample];
+        const int blockLength = juce::jmin(maxBlockSize, numSamples - start);
+        juce::dsp::AudioBlock<SampleType> block(buffer.getArrayOfWritePointers(), (size_t)numChannels, (size_t)start, (size_t)blockLength);
+
+        if (oversampler == nullptr)
+        {
+            processDelayLine(block, settings, kernelSettings, inverseRate, quadrature);
+        }
+        else
+        {
+            juce::dsp::AudioBlock<SampleType> oversampled;
+
+            {
+                FLANGER_TRACE_SCOPE("upsampling");
+                oversampled = oversampler->processSamplesUp(block).getSubsetChannelBlock(0, (size_t)numChannels);
             }
-            else if (interpolP == kQuadratic) {
-                int sample1 = (int)floorf(dpr);
-                int sample2 = (sample1 + 1) % delayBufferLength;
-                int sample0 = (sample1 - 1 + delayBufferLength) % delayBufferLength;
-           
-                float fraction = dpr - floorf(dpr);
-                float a0 = 0.5f * (delayData[sample0] - delayData[sample2]);
-                float a1 = 1 / (delayData[sample0] - 2.0f * delayData[sample1] + delayData[sample2]);
-                float a2 = a0 * a1;
-
-                interpolatedSample = delayData[sample1] - 0.25f * fraction * a2 * (delayData[sample0] - delayData[sample2]);
+
+            processDelayLine(oversampled, settings, kernelSettings, inverseRate, quadrature);
+
+            {
+                FLANGER_TRACE_SCOPE("downsampling");
+                oversampler->processSamplesDown(block);
             }
-            else if (interpolP == kCubic) {
+        }
 
-                // Cubic interpolation will produce cleaner results at the expense
-                // of more computation. This code uses the Catmull-Rom variant of
-                // cubic interpolation. To reduce the load, calculate a few quantities
-                // in advance that will be used several times in the equation:
+        start += blockLength;
+    }
 
-                int sample1 = (int)floorf(dpr);
-                int sample2 = (sample1 + 1) % delayBufferLength;
-                int sample3 = (sample2 + 1) % delayBufferLength;
-                int sample0 = (sample1 - 1 + delayBufferLength) % delayBufferLength;
+    // After a silent block, the delay line only ever decays. Once nothing within reach of
+    // the read positions is audible any more, clear it, so it resumes from true silence
+    // wherever the write pointer has got to by then, and go idle.
+    const int reachableFrames = juce::jmin(getReachableFrames(rate), engine.delayLine.getLength());
 
-                float fraction = dpr - floorf(dpr);
-                float frsq = fraction * fraction;
+    if (inputSilent && engine.delayLine.getPeak(delayBufferWrite, reachableFrames) <= (SampleType)kSilenceThreshold)
+    {
+        clearEngine<SampleType>();
+        idle = true;
+    }
+}
 
-                float a0 = -0.5f * delayData[sample0] + 1.5f * delayData[sample1]
-                    - 1.5f * delayData[sample2] + 0.5f * delayData[sample3];
-                float a1 = delayData[sample0] - 2.5f * delayData[sample1]
-                    + 2.0f * delayData[sample2] - 0.5f * delayData[sample3];
-                float a2 = -0.5f * delayData[sample0] + 0.5f * delayData[sample2];
-                float a3 = delayData[sample1];
+template <typename SampleType>
+void FlangerAudioProcessor::processDelayLine(juce::dsp::AudioBlock<SampleType> block, FlangerModulation::Settings settings,
+                                             FlangerKernel::KernelSettings kernelSettings, double inverseRate,
+                                             bool quadrature) noexcept
+{
+    auto& engine = getEngine<SampleType>();
+    const int numLanes = engine.delayLine.getNumChannels();
+    const int numChannels = (int)block.getNumChannels();
+    const int blockLength = (int)block.getNumSamples();
+
+    jassert(blockLength <= modulation.getMaxBlockSize());
+
+    // Nothing from scratch outlives the block it was taken for. It's all taken up front,
+    // so that if prepareToPlay didn't make room for this block, the block passes
+    // through dry before any state has moved.
+    scratch.reset();
+
+    const bool speedRamped = speedSmoother.isSmoothing();
+    const int numSpareLanes = juce::jmax(0, numLanes - numChannels);
+    float* const ramps = scratch.allocate<float>((size_t)(kNumSmoothingRamps * blockLength));
+    auto* const phaseIncrementRamp = speedRamped ? scratch.allocate<FlangerLfo::Phase>((size_t)blockLength) : nullptr;
+    SampleType* const spareLanes = numSpareLanes > 0 ? scratch.allocate<SampleType>((size_t)(numSpareLanes * blockLength))
+                                                     : nullptr;
+
+    if (!modulation.prepareBlock(scratch, blockLength) || ramps == nullptr
+        || (speedRamped && phaseIncrementRamp == nullptr) || (numSpareLanes > 0 && spareLanes == nullptr))
+        return;
+
+    // The shortest delay the LFO can reach this block. While it's longer than a kernel
+    // sub-block, feedback can't reach back into the sub-block being processed. Ramps run
+    // in a straight line or curve monotonically towards their targets, so the extremes of
+    // the delay and sweep are at one end or the other.
+    const float shortestDelayMs = juce::jmin(delaySmoother.getCurrentValue(), delaySmoother.getTargetValue());
+    const float mostNegativeSweepMs = juce::jmin(0.0f, sweepSmoother.getCurrentValue(), sweepSmoother.getTargetValue());
+    const int minimumDelaySamples = (int)((shortestDelayMs + mostNegativeSweepMs) * settings.samplesPerMs);
+
+    FlangerKernel::Mix mix;
 
-                interpolatedSample = a0 * fraction * frsq + a1 * frsq + a2 * fraction + a3;
+    {
+        FLANGER_TRACE_SCOPE("smoothing");
 
-            }
+        // Ramps are only written for parameters that are moving; otherwise the block uses
+        // the constants and kernels that don't read ramps at all
+        auto getRamp = [ramps, blockLength](int slot) { return ramps + slot * blockLength; };
 
+        settings.delayMs = delaySmoother.getCurrentValue();
+        settings.sweepMs = sweepSmoother.getCurrentValue();
 
-            // Store the current information in the delay buffer. With feedback, what we read is
-            // included in what gets stored in the buffer, otherwise it's just a simple delay line
-            // of the input signal.
+        if (delaySmoother.isSmoothing() || sweepSmoother.isSmoothing())
+        {
+            delaySmoother.process(getRamp(kDelayRamp), blockLength);
+            sweepSmoother.process(getRamp(kSweepRamp), blockLength);
+            settings.delayMsRamp = getRamp(kDelayRamp);
+            settings.sweepMsRamp = getRamp(kSweepRamp);
+        }
 
-            delayData[dpw] = in + (interpolatedSample * fbP);
+        settings.phaseIncrement = FlangerLfo::getPhaseIncrement(speedSmoother.getCurrentValue(), inverseRate);
 
-            // Increment the write pointer at a constant rate. The read pointer will move at different
-            // rates depending on the settings of the LFO, the delay and the sweep width.
+        if (speedRamped)
+        {
+            float* speedRamp = getRamp(kSpeedRamp);
+            speedSmoother.process(speedRamp, blockLength);
 
-            if (++dpw >= delayBufferLength)
-                dpw = 0;
+            for (int i = 0; i < blockLength; ++i)
+                phaseIncrementRamp[i] = FlangerLfo::getPhaseIncrement(speedRamp[i], inverseRate);
 
-            // Store the output sample in the buffer, replacing the input
-            //channelInData[i] = in + gP * interpolatedSample;
-            delayBuffer.setSample(channel, dpw, in + gP * interpolatedSample);
+            settings.phaseIncrementRamp = phaseIncrementRamp;
+        }
 
-            // Update the LFO phase, keeping it in the range 0-1
-            ph += speedP * inverseSampleRate;
+        mix.feedback = feedbackSmoother.getCurrentValue();
+        mix.depth = depthSmoother.getCurrentValue();
 
-            if (ph >= 1.0)
-                ph -= 1.0;
+        if (feedbackSmoother.isSmoothing() || depthSmoother.isSmoothing())
+        {
+            feedbackSmoother.process(getRamp(kFeedbackRamp), blockLength);
+            depthSmoother.process(getRamp(kDepthRamp), blockLength);
+            mix.feedbackRamp = getRamp(kFeedbackRamp);
+            mix.depthRamp = getRamp(kDepthRamp);
         }
+    }
+
+    // The kernel is specialised for everything that can't change within the block
+    kernelSettings.feedback = mix.feedbackRamp != nullptr || mix.feedback < 0.0f || mix.feedback > 0.0f;
+    kernelSettings.ramped = mix.feedbackRamp != nullptr;
+
+    const auto kernel = FlangerKernel::getKernel<SampleType>(kernelSettings);
+
+    FlangerModulation::Trajectory trajectories[FlangerModulation::kMaxTrajectories];
+
+    {
+        FLANGER_TRACE_SCOPE("modulation");
 
-        // Use channel 0 only to keep the phase in sync between calls to processBlock()
-        // Otherwise quadrature phase on multiple channels will create problems.
-        if (channel == 0)
-            channel0EndPhase = ph;
+        trajectories[0] = modulation.compute(0, lfoPhase, delayBufferWrite, blockLength, settings);
+
+        if (quadrature)
+            trajectories[1] = modulation.compute(1, lfoPhase + FlangerLfo::kQuarterCycle,
+                                                 delayBufferWrite, blockLength, settings);
     }
 
-    // Having made a local copy of the state variables for each channel, now transfer the result
-    // back to the main state variable so they will be preserved for the next call of processBlock()
+    // Every channel has its own lane of the delay line but they share the write pointer,
+    // so a channel's trajectory only depends on its LFO phase. Input channels beyond
+    // the lanes prepareToPlay allocated pass through dry, and lanes with no input
+    // channel run on silence.
+    SampleType* channels[FlangerKernel::kMaxChannels];
+    const FlangerModulation::Trajectory* channelTrajectories[FlangerKernel::kMaxChannels];
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        if (lane < numChannels)
+        {
+            channels[lane] = block.getChannelPointer((size_t)lane);
+        }
+        else
+        {
+            channels[lane] = spareLanes + (lane - numChannels) * blockLength;
+            std::fill(channels[lane], channels[lane] + blockLength, SampleType());
+        }
+
+        channelTrajectories[lane] = &trajectories[quadrature && lane != 0 ? 1 : 0];
+    }
 
-    delayBufferWrite = dpw;
-    lfoPhase = channel0EndPhase;
+    {
+        FLANGER_TRACE_SCOPE("channels");
+
+        // Gather and interpolate, then store the input plus feedback in the delay
+        // buffer and mix the delayed signal into the output. With feedback, what we read is
+        // included in what gets stored in the buffer, otherwise it's just a simple delay line
+        // of the input signal.
+        kernel(channels, blockLength, engine.delayLine, channelTrajectories, delayBufferWrite, mix, minimumDelaySamples,
+               engine.kernelState);
+    }
+
+    // Advance the shared state past this block; the LFO accumulator wraps by itself
+    delayBufferWrite = (delayBufferWrite + blockLength) & engine.delayLine.getMask();
+    writtenFrames = juce::jmin(writtenFrames + blockLength, engine.delayLine.getLength());
+    lfoPhase = FlangerModulation::advance(lfoPhase, blockLength, settings);
+}
+
+void FlangerAudioProcessor::resetSmoothers() noexcept
+{
+    delaySmoother.reset(delay);
+    sweepSmoother.reset(sweep);
+    depthSmoother.reset(g);
+    feedbackSmoother.reset(fb);
+    speedSmoother.reset(speed);
+}
+
+template <typename SampleType>
+void FlangerAudioProcessor::clearEngine() noexcept
+{
+    auto& engine = getEngine<SampleType>();
+
+    engine.delayLine.clear(delayBufferWrite, juce::jmin(writtenFrames, engine.delayLine.getLength()));
+    writtenFrames = 0;
+    engine.kernelState = {};
+
+    if (auto* oversampler = engine.getOversampler(activeOversampling, activeOversamplingFilter))
+        oversampler->reset();
+}
+
+int FlangerAudioProcessor::getReachableFrames(const RateConstants& rate) const noexcept
+{
+    // Ramps end at one end or the other, as in processDelayLine; the LFO adds up to the
+    // whole sweep, and the interpolators read at most a guard's worth of taps either side
+    const float reachMs = juce::jmax(delaySmoother.getCurrentValue(), delaySmoother.getTargetValue())
+                          + juce::jmax(0.0f, sweepSmoother.getCurrentValue(), sweepSmoother.getTargetValue());
+
+    return (int)std::ceil(reachMs * rate.samplesPerMs) + FlangerDelayLine<float>::kGuardSamples;
+}
+
+int FlangerAudioProcessor::getDelayLineFrames(int tier) const noexcept
+{
+    return (int)std::ceil(longestDelayMs * rateConstants[tier].samplesPerMs) + FlangerDelayLine<float>::kGuardSamples
+           + FlangerKernel::kVectorBlock + 1;
+}
+
+int FlangerAudioProcessor::getOversamplingLatency() const noexcept
+{
+    // The tier and filter from the store, which the audio thread switches to at its next block
+    const int tier = juce::jlimit(0, kNumOversamplingTiers - 1, juce::roundToInt(parameterStore.get(kOversamplingParam)));
+    const int filter = juce::jlimit(0, kNumOversamplingFilters - 1,
+                                    juce::roundToInt(parameterStore.get(kOversamplingFilterParam)));
+
+    return oversamplingLatencies[tier][filter].load(std::memory_order_relaxed);
 }
 //==============================================================================
 
 
+//==============================================================================
+DspLoadMeter::Statistics FlangerAudioProcessor::getLoadStatistics() const
+{
+    return loadMeter.getStatistics();
+}
+
+void FlangerAudioProcessor::resetLoadStatistics()
+{
+    loadMeter.reset();
+}
+
 //==============================================================================
 bool FlangerAudioProcessor::hasEditor() const
 {
@@ -463,15 +1041,21 @@ juce::AudioProcessorEditor* FlangerAudioProcessor::createEditor()
 //==============================================================================
 void FlangerAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    // Every parameter, as the value tree state's XML
+    if (auto xml = parameters.copyState().createXml())
+        copyXmlToBinary(*xml, destData);
 }
 
 void FlangerAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    FLANGER_TRACE_SCOPE("setStateInformation");
+
+    // Replacing the state sets every parameter, which reaches the audio thread through the
+    // store like any other change. Anything that isn't our state is ignored.
+    const auto xml = getXmlFromBinary(data, sizeInBytes);
+
+    if (xml != nullptr && xml->hasTagName(parameters.state.getType()))
+        parameters.replaceState(juce::ValueTree::fromXml(*xml));
 }
 
 //==============================================================================
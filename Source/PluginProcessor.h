@@ -9,13 +9,81 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "DspLoadMeter.h"
+#include "FlangerDelayLine.h"
+#include "FlangerKernel.h"
+#include "FlangerLfo.h"
+#include "FlangerModulation.h"
+#include "FlangerParameterStore.h"
+#include "FlangerScratchArena.h"
+#include "FlangerSmoother.h"
+#include "PerfCounters.h"
 
 //==============================================================================
 /**
 */
-class FlangerAudioProcessor : public juce::AudioProcessor
+class FlangerAudioProcessor : public juce::AudioProcessor,
+                              private juce::AudioProcessorValueTreeState::Listener,
+                              private juce::Timer
 {
 public:
+    //==============================================================================
+    enum Parameters
+    {
+
+        kDelayParam = 0,
+        kSweepParam,
+        kDepthParam,
+        kWetParam,
+        kWaveParam,
+        kInterpolParam,
+        kFbParam,
+        kFrequencyParam,
+        kStereoParam,
+        kOversamplingParam,
+        kOversamplingFilterParam,
+        kNumParameters
+    };
+
+    enum Waves
+    {
+        kSineWave = 0,
+        kTrWave,
+        kSqWave,
+        kSawWave
+    };
+
+    enum Interpol
+    {
+        kLinear = 0,
+        kQuadratic,
+        kCubic,
+        kLagrange3,
+        kLagrange5,
+        kSinc,
+        kThiran
+    };
+
+    // The delay line and feedback loop run at 1, 2, 4 or 8 times the host rate
+    enum OversamplingTier
+    {
+        kOversampling1x = 0,
+        kOversampling2x,
+        kOversampling4x,
+        kOversampling8x,
+        kNumOversamplingTiers
+    };
+
+    enum OversamplingFilter
+    {
+        kPolyphaseIIR = 0,      // cheaper, but not linear phase
+        kEquirippleFIR,         // linear phase, at the cost of more latency and CPU
+        kNumOversamplingFilters
+    };
+
+    // Input, and delay line contents, within this of zero count as silence (-100 dB)
+    static constexpr float kSilenceThreshold = 1.0e-5f;
+
     //==============================================================================
     FlangerAudioProcessor();
     ~FlangerAudioProcessor() override;
@@ -24,11 +92,20 @@ public:
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
 
+    // Drops the audio in flight, for seeks and loop points. Clears only what was written
+    // since the delay line was last cleared, and never allocates, since hosts may call it
+    // on the audio thread between blocks.
+    void reset() override;
+
 #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
 
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+
+    // Double blocks run double kernels on a double delay line rather than being converted
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -55,12 +132,20 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
-    // LFO function
-    float FlangerAudioProcessor::lfo(int ph, int waveform);
+    // The host-visible parameters, for the editor's attachments and the state
+    juce::AudioProcessorValueTreeState& getValueTreeState() noexcept { return parameters; }
 
-    // Declaration of function 
+    // The ID of each Parameters entry in the value tree state
+    static juce::String getParameterID(int index);
+
+    // Parameters by Parameters index, in their plain units. setParameter() notifies the
+    // host as if the parameter had been moved in the editor, which goes through JUCE's
+    // listener locks, so it belongs on the message thread. getParameter() and
+    // automateParameter() are safe on the audio thread: automateParameter() takes effect
+    // from the next block, and the host hears about it from timerCallback().
     float getParameter(int index);
     void setParameter(int index, float newValue);
+    void automateParameter(int index, float newValue) noexcept;
     const juce::String getParameterName(int index);
     const juce::String getParameterText(int index);
     const juce::String getInputChannelName(int channelIndex) const;
@@ -70,60 +155,241 @@ public:
 
     //bool silenceInProducesSilenceOut() const;
 
+    // processBlock timing against each block's realtime budget; safe to call from the message thread
+    DspLoadMeter::Statistics getLoadStatistics() const;
+    void resetLoadStatistics();
+
+    // The latency the selected oversampling filters add, in host-rate samples, as of the
+    // last prepareToPlay. Any thread.
+    int getOversamplingLatency() const noexcept;
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    // Hardware counter deltas summed over every processBlock call since the last reset
+    const PerfCounters::Totals& getPerfCounterTotals() const { return perfTotals; }
+    void resetPerfCounterTotals() { perfTotals.reset(); }
+#endif
+
 
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FlangerAudioProcessor)
 
-    // Variables for the delay circular buffer: length, actual circular buffer, read and write pointers
-    int delayBufferLength;
-    juce::AudioSampleBuffer delayBuffer;
-    int delayBufferRead;
-    int delayBufferWrite;
+    static constexpr int kMaxOversamplingFactor = 1 << (kNumOversamplingTiers - 1);
 
-    enum Parameters
-    {
+    // How long the continuous parameters take to glide to a new value
+    static constexpr double kSmoothingMs = 50.0;
 
-        kDelayParam = 0,
-        kSweepParam,
-        kDepthParam,
-        kWetParam,
-        kWaveParam,
-        kInterpolParam,
-        kFbParam,
-        kFrequencyParam,
-        kStereoParam,
-        kNumParameters
+    // Everything that depends on the rate the delay line runs at, worked out in
+    // prepareToPlay for each oversampling tier
+    struct RateConstants
+    {
+        double inverseRate = 0.0;   // the sample period; the LFO's phase increment per Hz, in cycles
+        float samplesPerMs = 0.0f;
+        int rampLength = 0;         // kSmoothingMs in samples
+        int delayLineFrames = 0;    // see getDelayLineFrames()
     };
 
-    enum Waves
+    // Everything that carries audio from one block to the next, at one sample precision.
+    // prepareToPlay only allocates it for the precision the host is going to process in.
+    template <typename SampleType>
+    struct Engine
     {
-        kSineWave = 0,
-        kTrWave,
-        kSqWave,
-        kSawWave
+        // Allocates and clears everything for blocks of up to maxBlockSize host samples, with
+        // room for maxDelayFrames of delay line. What's already allocated is reused where
+        // it's big enough: the oversamplers don't depend on the rate, so they're only
+        // rebuilt for a different lane count or a larger block size.
+        void prepare(int numLanes, int maxDelayFrames, int maxBlockSize);
+
+        // nullptr for 1x, or before prepare()
+        juce::dsp::Oversampling<SampleType>* getOversampler(int tier, int filter) const noexcept;
+
+        // Every channel interleaved in one line
+        FlangerDelayLine<SampleType> delayLine;
+
+        // What the interpolator carries between blocks (the Thiran allpass's last outputs)
+        FlangerKernel::KernelState<SampleType> kernelState;
+
+        // One oversampler per tier above 1x and filter type, all built in prepare(), so
+        // switching between them never allocates on the audio thread
+        std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversamplers[kNumOversamplingTiers - 1][kNumOversamplingFilters];
+        int oversamplerLanes = 0;
+        int oversamplerBlockSize = 0;
+
+        // The delay line's audio while it's carried across a reprepare or tier switch, before
+        // and after resampling; prepareEngine sizes them for a whole ring at the highest tier
+        std::vector<SampleType> history;
+        std::vector<SampleType> resampledHistory;
     };
 
-    enum Interpol
+    template <typename SampleType>
+    Engine<SampleType>& getEngine() noexcept;
+
+    // Prepares the engine for SampleType. If it was already running with numLanes lanes,
+    // the audio its delay line held is carried over, resampled from previousRate to the
+    // rate it runs at now, so a reprepare mid-session doesn't cut the sound off.
+    template <typename SampleType>
+    void prepareEngine(int numLanes, double previousRate);
+
+    // Writes the first numFrames frames of the engine's history, recorded at previousRate,
+    // back into its delay line at oversampling tier's rate, newest just behind a write
+    // pointer moved to 0, and silences the rest of what a read can reach. Frames beyond
+    // that reach are dropped, and the rest of the ring is left for the write pointer to
+    // overwrite, so the cost follows the tier's delayLineFrames rather than the ring.
+    // Doesn't allocate, so a tier switch can use it on the audio thread.
+    template <typename SampleType>
+    void restoreHistory(int numFrames, double previousRate, int tier) noexcept;
+
+    // Both processBlock()s
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
+    // Runs one block through the smoothers, the modulation stage and the kernel, at whatever
+    // rate the block is at. settings and kernelSettings hold everything that doesn't depend
+    // on the smoothed parameters; inverseRate is the block's sample period.
+    template <typename SampleType>
+    void processDelayLine(juce::dsp::AudioBlock<SampleType> block, FlangerModulation::Settings settings,
+                          FlangerKernel::KernelSettings kernelSettings, double inverseRate, bool quadrature) noexcept;
+
+    // Jumps every smoother to its parameter's current value
+    void resetSmoothers() noexcept;
+
+    // Silences the delay line, by clearing the frames written since it was last cleared,
+    // and clears the interpolator state and the active oversampler
+    template <typename SampleType>
+    void clearEngine() noexcept;
+
+    // How many frames before the write pointer the read positions can reach, at the
+    // smoothed delay and sweep and the rate the delay line runs at
+    int getReachableFrames(const RateConstants& rate) const noexcept;
+
+    // How long the delay line has to be at an oversampling tier for the longest delay and
+    // sweep the parameter ranges allow, plus the interpolators' taps and a kernel
+    // sub-block written ahead of the reads
+    int getDelayLineFrames(int tier) const noexcept;
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+
+    // Called from whichever thread a parameter was set on, which may be the audio thread,
+    // so it only updates parameterStore
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+
+    // Passes automateParameter()'s changes on to the host, and reports the selected
+    // oversampling tier's latency. Neither can be done from the audio thread, so the
+    // message thread polls for them here.
+    void timerCallback() override;
+
+    // Copies every parameter out of the store into the members at the bottom
+    void readParameters() noexcept;
+
+    // What the host and editor see; every change is mirrored into parameterStore, which
+    // is all the audio thread reads
+    FlangerParameterStore parameterStore { kNumParameters };
+    juce::AudioProcessorValueTreeState parameters;
+
+    // parameters' entries by Parameters index, looked up once so setParameter() and
+    // parameterChanged() don't build ID strings
+    juce::RangedAudioParameter* parameterObjects[kNumParameters] {};
+
+    // One bit per Parameters index that automateParameter() has changed and the host
+    // hasn't been told about yet
+    std::atomic<uint32_t> pendingNotifications { 0 };
+    static_assert(kNumParameters <= 32, "pendingNotifications needs a bit per parameter");
+
+    // The parameter timerCallback() is passing on, whose value parameterChanged() mustn't
+    // copy back over a newer one automateParameter() may have put in the store since
+    std::atomic<int> notifyingIndex { -1 };
+
+    // parameterStore's version when the members below were last read from it
+    uint32_t parameterVersion = 0;
+
+    // The delay line, oversamplers and so on for float and for double blocks
+    Engine<float> floatEngine;
+    Engine<double> doubleEngine;
+
+    // Read and write pointers of the delay circular buffer, whichever precision it's in
+    int delayBufferRead;
+    int delayBufferWrite;
+
+    // How many frames before the write pointer have been written since the delay line was
+    // last cleared, up to its length: everything else a read can reach is still silent
+    int writtenFrames = 0;
+
+    // Carries on from where it was across a reprepare, like the delay line's audio
+    FlangerLfo::Phase lfoPhase = 0;
+
+    RateConstants rateConstants[kNumOversamplingTiers];
+
+    // The host rate the last prepareToPlay was for, or 0 before the first
+    double preparedSampleRate = 0.0;
+
+    // The top of the delay range plus the top of the sweep range, in milliseconds; read in
+    // prepareToPlay, so the audio thread never has to look the ranges up
+    float longestDelayMs = 0.0f;
+
+    // Read positions for the current block, computed ahead of the interpolation kernel
+    FlangerModulation modulation;
+
+    // The continuous parameters, smoothed at the rate the delay line runs at. While any of
+    // them moves, its per-sample values for the block go in its slot of the block's ramps,
+    // and the LFO rate's, converted to phase increments, in one more ramp, all in scratch.
+    enum SmoothingRamp
     {
-        kLinear = 0,
-        kQuadratic,
-        kCubic
+        kDelayRamp = 0,
+        kSweepRamp,
+        kDepthRamp,
+        kFeedbackRamp,
+        kSpeedRamp,
+        kNumSmoothingRamps
     };
 
-    float lfoPhase;
-    double inverseSampleRate;
-
-    // Variables for the flanger parameters
-    float delay;
-    float wet;
-    float fb;
-    float sweep;
-    float g;
-    float speed; // frequency
-    float time;
-    int polarity;
-    int interpol;
-    int wave;
-    int stereo;
+    FlangerSmoother delaySmoother { FlangerSmoother::kLinear };
+    FlangerSmoother sweepSmoother { FlangerSmoother::kLinear };
+    FlangerSmoother depthSmoother { FlangerSmoother::kExponential };
+    FlangerSmoother feedbackSmoother { FlangerSmoother::kExponential };
+    FlangerSmoother speedSmoother { FlangerSmoother::kLinear };
+
+    // Every block's working memory: the modulation's arrays, the smoothing ramps and the
+    // stand-in audio for delay line lanes beyond the input channels. Sized in prepareToPlay
+    // for the largest block, and rewound at the start of each one.
+    FlangerScratchArena scratch;
+
+    // Set once the input is silent and nothing audible is left within reach of the read
+    // positions; the delay line is cleared then, and until the input comes back, blocks
+    // pass straight through and only the LFO phase and write pointer move
+    bool idle = false;
+
+    int activeOversampling = kOversampling1x;
+    int activeOversamplingFilter = kPolyphaseIIR;
+
+    // Every tier and filter's latency in host-rate samples, filled in by prepareToPlay, so
+    // the message thread never touches oversamplers prepareToPlay may be rebuilding
+    std::atomic<int> oversamplingLatencies[kNumOversamplingTiers][kNumOversamplingFilters] {};
+
+    // The largest host block processed in one go; longer ones are split
+    int maxBlockSize = 0;
+
+    DspLoadMeter loadMeter;
+
+#if FLANGER_ENABLE_PERF_COUNTERS
+    // Profiling builds only. Opened on the first processBlock call, since the
+    // counters follow the thread that opens them, which must be the audio thread.
+    std::unique_ptr<PerfCounters> perfCounters;
+    PerfCounters::Totals perfTotals;
+#endif
+
+    // Variables for the flanger parameters (delay and sweep in milliseconds): the audio
+    // thread's snapshot of parameterStore, taken at the start of any block after a change
+    float delay = 15.0f;
+    float wet = 1.0f;
+    float fb = 0.8f;
+    float sweep = 0.7f;
+    float g = 1.0f;
+    float speed = 5.0f; // frequency
+    float time = 0.0f;
+    int polarity = 0;
+    int interpol = kLinear;
+    int wave = kSineWave;
+    int stereo = 0;
+    int oversampling = kOversampling1x;
+    int oversamplingFilter = kPolyphaseIIR;
 };
\ No newline at end of file
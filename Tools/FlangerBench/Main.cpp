@@ -0,0 +1,546 @@
+/*
+  ==============================================================================
+
+    Microbenchmarks for FlangerAudioProcessor::processBlock.
+
+    Runs every interpolation mode x waveform x oversampling tier x block size x
+    sample rate combination, plus juce::dsp::DelayLine and juce::dsp::Chorus
+    baselines at the same block sizes and rates, and writes the results as JSON
+    so runs can be compared between releases. A last set of runs switches
+    oversampling tier on every block, to time the blocks that carry the delay
+    line's audio over to a new tier.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <vector>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    constexpr int benchmarkChannels = 2;
+
+    const char* const interpolationNames[] = { "linear", "quadratic", "cubic", "lagrange3", "lagrange5", "sinc8", "thiran" };
+
+    static_assert(sizeof(interpolationNames) / sizeof(interpolationNames[0]) == FlangerKernel::kNumInterpolations,
+                  "Every interpolation mode needs a name");
+    const char* const waveformNames[] = { "sine", "triangle", "square", "saw" };
+    const char* const oversamplingNames[] = { "1x", "2x", "4x", "8x" };
+    const char* const oversamplingFilterNames[] = { "iir", "fir" };
+
+    // Opened once on the main thread, which runs every measurement
+    const PerfCounters& getPerfCounters()
+    {
+        static const PerfCounters counters;
+        return counters;
+    }
+
+    //==============================================================================
+    juce::uint64 readCycleCounter()
+    {
+       #if JUCE_INTEL
+        return (juce::uint64)__rdtsc();
+       #else
+        return 0;
+       #endif
+    }
+
+    bool hasCycleCounter()
+    {
+       #if JUCE_INTEL
+        return true;
+       #else
+        return false;
+       #endif
+    }
+
+    struct Measurement
+    {
+        double nsPerSample = 0.0;      // median over the repeats
+        double nsPerSampleMin = 0.0;
+        double cyclesPerSample = 0.0;  // median, from the TSC or estimated from the nominal clock
+
+        // Hardware counter events per frame over all repeats, when --perf found any counters
+        bool hasPerfCounters = false;
+        std::array<double, PerfCounters::kNumCounters> eventsPerSample {};
+    };
+
+    struct BenchmarkSettings
+    {
+        int samplesPerRun = 1 << 16;
+        int repeats = 5;
+        const PerfCounters* perfCounters = nullptr;  // only set with --perf when the counters opened
+    };
+
+    // Times processBlockFn over samplesPerRun frames split into blocks of blockSize.
+    // Every block is refreshed from a noise source first, so feedback can't make the
+    // signal blow up or decay into denormals between blocks; the copy is part of the
+    // measured time but is negligible next to any of the kernels.
+    template <typename ProcessBlockFn>
+    Measurement measure(ProcessBlockFn&& processBlockFn, int blockSize, const BenchmarkSettings& settings)
+    {
+        juce::AudioBuffer<float> source(benchmarkChannels, 8192);
+        juce::Random random(0x5eed);
+
+        for (int ch = 0; ch < benchmarkChannels; ++ch)
+            for (int i = 0; i < source.getNumSamples(); ++i)
+                source.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+
+        juce::AudioBuffer<float> work(benchmarkChannels, blockSize);
+
+        auto runOnce = [&](double& seconds, double& cycles)
+        {
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            const auto startCycles = readCycleCounter();
+
+            for (int position = 0; position < settings.samplesPerRun; position += blockSize)
+            {
+                const int offset = position & 4095;
+
+                for (int ch = 0; ch < benchmarkChannels; ++ch)
+                    work.copyFrom(ch, 0, source, ch, offset, blockSize);
+
+                processBlockFn(work);
+            }
+
+            cycles = (double)(readCycleCounter() - startCycles);
+            seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        };
+
+        double seconds, cycles;
+        runOnce(seconds, cycles); // warm up caches and the branch predictor
+
+        std::vector<double> nsPerSample, cyclesPerSample;
+        PerfCounters::Totals perfTotals;
+
+        for (int repeat = 0; repeat < settings.repeats; ++repeat)
+        {
+            const auto countsBefore = settings.perfCounters != nullptr ? settings.perfCounters->read() : PerfCounters::Values {};
+            runOnce(seconds, cycles);
+
+            if (settings.perfCounters != nullptr)
+                perfTotals.add(countsBefore, settings.perfCounters->read(), settings.samplesPerRun);
+
+            nsPerSample.push_back(seconds * 1.0e9 / settings.samplesPerRun);
+            cyclesPerSample.push_back(cycles / settings.samplesPerRun);
+        }
+
+        std::sort(nsPerSample.begin(), nsPerSample.end());
+        std::sort(cyclesPerSample.begin(), cyclesPerSample.end());
+
+        Measurement m;
+        m.nsPerSample = nsPerSample[nsPerSample.size() / 2];
+        m.nsPerSampleMin = nsPerSample.front();
+
+        if (hasCycleCounter())
+            m.cyclesPerSample = cyclesPerSample[cyclesPerSample.size() / 2];
+        else
+            m.cyclesPerSample = m.nsPerSample * juce::SystemStats::getCpuSpeedInMegahertz() * 1.0e-3;
+
+        if (settings.perfCounters != nullptr)
+        {
+            m.hasPerfCounters = true;
+
+            for (int i = 0; i < PerfCounters::kNumCounters; ++i)
+                m.eventsPerSample[(size_t)i] = perfTotals.getPerSample((PerfCounters::Counter)i);
+        }
+
+        return m;
+    }
+
+    //==============================================================================
+    // The flanger's default parameters, so the baselines do comparable work
+    struct FlangerSettings
+    {
+        float delayMs, sweepMs, depth, feedback, frequency;
+
+        static FlangerSettings fromDefaults()
+        {
+            FlangerAudioProcessor defaults;
+            return { defaults.getParameter(FlangerAudioProcessor::kDelayParam),
+                     defaults.getParameter(FlangerAudioProcessor::kSweepParam),
+                     defaults.getParameter(FlangerAudioProcessor::kDepthParam),
+                     defaults.getParameter(FlangerAudioProcessor::kFbParam),
+                     defaults.getParameter(FlangerAudioProcessor::kFrequencyParam) };
+        }
+    };
+
+    Measurement measureFlanger(int interpolation, int waveform, int oversampling, int oversamplingFilter,
+                               double sampleRate, int blockSize, const BenchmarkSettings& settings)
+    {
+        FlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(benchmarkChannels, benchmarkChannels, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.setParameter(FlangerAudioProcessor::kInterpolParam, (float)interpolation);
+        processor.setParameter(FlangerAudioProcessor::kWaveParam, (float)waveform);
+        processor.setParameter(FlangerAudioProcessor::kOversamplingParam, (float)oversampling);
+        processor.setParameter(FlangerAudioProcessor::kOversamplingFilterParam, (float)oversamplingFilter);
+
+        juce::MidiBuffer midi;
+        auto result = measure([&](juce::AudioBuffer<float>& buffer) { processor.processBlock(buffer, midi); },
+                              blockSize, settings);
+
+        processor.releaseResources();
+        return result;
+    }
+
+    // The same, but switching between oversampling tiers fromTier and toTier on every block,
+    // so each block also resamples what the delay line holds to the new tier's rate
+    Measurement measureTierSwitch(int interpolation, int waveform, int fromTier, int toTier, int oversamplingFilter,
+                                  double sampleRate, int blockSize, const BenchmarkSettings& settings)
+    {
+        FlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(benchmarkChannels, benchmarkChannels, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.setParameter(FlangerAudioProcessor::kInterpolParam, (float)interpolation);
+        processor.setParameter(FlangerAudioProcessor::kWaveParam, (float)waveform);
+        processor.setParameter(FlangerAudioProcessor::kOversamplingFilterParam, (float)oversamplingFilter);
+
+        juce::MidiBuffer midi;
+        bool atFromTier = false;
+
+        auto result = measure([&](juce::AudioBuffer<float>& buffer)
+        {
+            atFromTier = !atFromTier;
+            processor.setParameter(FlangerAudioProcessor::kOversamplingParam, (float)(atFromTier ? fromTier : toTier));
+            processor.processBlock(buffer, midi);
+        }, blockSize, settings);
+
+        processor.releaseResources();
+        return result;
+    }
+
+    // A sine-modulated feedback delay written against juce::dsp::DelayLine, i.e. the
+    // flanger's inner loop built from the stock JUCE parts
+    template <typename InterpolationType>
+    Measurement measureDelayLine(double sampleRate, int blockSize, const BenchmarkSettings& settings)
+    {
+        const auto flanger = FlangerSettings::fromDefaults();
+        const float samplesPerMs = (float)(sampleRate * 0.001);
+        const float phaseIncrement = (float)(flanger.frequency / sampleRate);
+
+        juce::dsp::DelayLine<float, InterpolationType> delayLine((int)((flanger.delayMs + flanger.sweepMs) * samplesPerMs) + 4);
+        delayLine.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)benchmarkChannels });
+        float lfoPhase = 0.0f;
+
+        return measure([&](juce::AudioBuffer<float>& buffer)
+        {
+            float phase = lfoPhase;
+
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+            {
+                auto* data = buffer.getWritePointer(ch);
+                phase = lfoPhase;
+
+                for (int i = 0; i < buffer.getNumSamples(); ++i)
+                {
+                    const float lfo = 0.5f + 0.5f * std::sin(juce::MathConstants<float>::twoPi * phase);
+                    const float delayed = delayLine.popSample(ch, (flanger.delayMs + flanger.sweepMs * lfo) * samplesPerMs);
+                    delayLine.pushSample(ch, data[i] + flanger.feedback * delayed);
+                    data[i] += flanger.depth * delayed;
+
+                    phase += phaseIncrement;
+                    if (phase >= 1.0f)
+                        phase -= 1.0f;
+                }
+            }
+
+            lfoPhase = phase;
+        }, blockSize, settings);
+    }
+
+    Measurement measureChorus(double sampleRate, int blockSize, const BenchmarkSettings& settings)
+    {
+        const auto flanger = FlangerSettings::fromDefaults();
+
+        juce::dsp::Chorus<float> chorus;
+        chorus.prepare({ sampleRate, (juce::uint32)blockSize, (juce::uint32)benchmarkChannels });
+        chorus.setRate(flanger.frequency);
+        chorus.setCentreDelay(flanger.delayMs);
+        chorus.setDepth(0.5f);
+        chorus.setFeedback(flanger.feedback);
+        chorus.setMix(0.5f);
+
+        return measure([&](juce::AudioBuffer<float>& buffer)
+        {
+            juce::dsp::AudioBlock<float> block(buffer);
+            chorus.process(juce::dsp::ProcessContextReplacing<float>(block));
+        }, blockSize, settings);
+    }
+
+    //==============================================================================
+    juce::var makeResult(const juce::String& kernel, const juce::String& interpolation, const juce::String& waveform,
+                         double sampleRate, int blockSize, const Measurement& m)
+    {
+        auto* result = new juce::DynamicObject();
+        result->setProperty("kernel", kernel);
+        result->setProperty("interpolation", interpolation);
+        result->setProperty("waveform", waveform);
+        result->setProperty("sample_rate", sampleRate);
+        result->setProperty("block_size", blockSize);
+        result->setProperty("ns_per_sample", m.nsPerSample);
+        result->setProperty("ns_per_sample_min", m.nsPerSampleMin);
+        result->setProperty("cycles_per_sample", m.cyclesPerSample);
+
+        if (m.hasPerfCounters)
+        {
+            const auto& perf = getPerfCounters();
+            auto* counters = new juce::DynamicObject();
+
+            for (int i = 0; i < PerfCounters::kNumCounters; ++i)
+                if (perf.isAvailable((PerfCounters::Counter)i))
+                    counters->setProperty(juce::String(PerfCounters::getName((PerfCounters::Counter)i)) + "_per_sample",
+                                          m.eventsPerSample[(size_t)i]);
+
+            if (perf.isAvailable(PerfCounters::kCycles) && perf.isAvailable(PerfCounters::kInstructions)
+                && m.eventsPerSample[PerfCounters::kCycles] > 0.0)
+                counters->setProperty("ipc", m.eventsPerSample[PerfCounters::kInstructions] / m.eventsPerSample[PerfCounters::kCycles]);
+
+            result->setProperty("perf_counters", juce::var(counters));
+        }
+
+        return juce::var(result);
+    }
+
+    // Adds the oversampling tier and the interpolator's nominal cost per sample and
+    // channel (at the oversampled rate), to set against the timings
+    juce::var withFlangerDetails(juce::var result, int interpolation, int oversampling, int oversamplingFilter)
+    {
+        const auto& cost = FlangerKernel::getInterpolatorCost(interpolation);
+
+        if (auto* object = result.getDynamicObject())
+        {
+            object->setProperty("oversampling", oversamplingNames[oversampling]);
+            object->setProperty("oversampling_filter", oversamplingFilterNames[oversamplingFilter]);
+            object->setProperty("taps", cost.numTaps);
+            object->setProperty("flops_per_sample", cost.flops);
+            object->setProperty("table_bytes", cost.tableBytes);
+            object->setProperty("recursive", cost.recursive);
+        }
+
+        return result;
+    }
+
+    // Parses "--name=a,b,c" into the indices of the matching names, or all of them if absent
+    juce::Array<int> parseNameList(const juce::ArgumentList& args, juce::StringRef option,
+                                   const char* const* names, int numNames)
+    {
+        juce::Array<int> indices;
+
+        if (!args.containsOption(option))
+        {
+            for (int i = 0; i < numNames; ++i)
+                indices.add(i);
+
+            return indices;
+        }
+
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption(option), ",", {}))
+        {
+            int i = 0;
+            while (i < numNames && token.trim() != names[i])
+                ++i;
+
+            if (i == numNames)
+                juce::ConsoleApplication::fail("Unknown value for " + juce::String(option) + ": " + token);
+
+            indices.add(i);
+        }
+
+        return indices;
+    }
+
+    juce::Array<int> parseIntList(const juce::ArgumentList& args, juce::StringRef option, juce::Array<int> defaults)
+    {
+        if (!args.containsOption(option))
+            return defaults;
+
+        juce::Array<int> values;
+
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption(option), ",", {}))
+            values.add(token.getIntValue());
+
+        return values;
+    }
+
+    void runBenchmarks(const juce::ArgumentList& args)
+    {
+        BenchmarkSettings settings;
+
+        if (args.containsOption("--samples"))
+            settings.samplesPerRun = juce::jmax(1, args.getValueForOption("--samples").getIntValue());
+
+        if (args.containsOption("--repeats"))
+            settings.repeats = juce::jmax(1, args.getValueForOption("--repeats").getIntValue());
+
+        const bool quick = args.containsOption("--quick");
+
+        const auto interpolations = parseNameList(args, "--interpolation", interpolationNames, FlangerKernel::kNumInterpolations);
+        const auto waveforms = parseNameList(args, "--waveform", waveformNames, 4);
+        const auto oversamplings = parseNameList(args, "--oversampling", oversamplingNames,
+                                                 FlangerAudioProcessor::kNumOversamplingTiers);
+        const auto oversamplingFilters = args.containsOption("--oversampling-filter")
+                                             ? parseNameList(args, "--oversampling-filter", oversamplingFilterNames,
+                                                             FlangerAudioProcessor::kNumOversamplingFilters)
+                                             : juce::Array<int> { FlangerAudioProcessor::kPolyphaseIIR };
+        const auto blockSizes = parseIntList(args, "--block-sizes",
+                                             quick ? juce::Array<int> { 1, 64, 512, 4096 }
+                                                   : juce::Array<int> { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 });
+        const auto sampleRates = parseIntList(args, "--sample-rates",
+                                              quick ? juce::Array<int> { 44100, 192000 }
+                                                    : juce::Array<int> { 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000 });
+        const bool runBaselines = !args.containsOption("--no-baselines");
+        const bool runTierSwitches = !args.containsOption("--no-tier-switches") && oversamplings.size() > 1;
+
+        // Counters only see the thread that opened them, which is the one running every measurement
+        juce::String perfStatus = "off";
+
+        if (args.containsOption("--perf"))
+        {
+            const auto& perf = getPerfCounters();
+
+            if (perf.isAvailable())
+                settings.perfCounters = &perf;
+
+            perfStatus = perf.getUnavailableReason().isEmpty() ? "on" : perf.getUnavailableReason();
+
+            if (!perf.isAvailable())
+                std::cerr << "Hardware counters unavailable (" << perfStatus << "), continuing without them" << std::endl;
+        }
+
+        juce::Array<juce::var> results;
+
+        auto report = [&results](const juce::var& result)
+        {
+            std::cerr << result["kernel"].toString() << " " << result["interpolation"].toString() << " "
+                      << result["waveform"].toString()
+                      << (result.hasProperty("oversampling") ? " " + result["oversampling"].toString() + " "
+                                                                 + result["oversampling_filter"].toString() : juce::String())
+                      << " @ " << (int)result["sample_rate"] << " Hz, block "
+                      << (int)result["block_size"] << ": " << juce::String((double)result["ns_per_sample"], 2)
+                      << " ns/sample" << std::endl;
+            results.add(result);
+        };
+
+        for (auto sampleRate : sampleRates)
+        {
+            for (auto blockSize : blockSizes)
+            {
+                for (auto oversampling : oversamplings)
+                    for (auto filter : (oversampling == FlangerAudioProcessor::kOversampling1x ? juce::Array<int> { 0 } : oversamplingFilters))
+                        for (auto interpolation : interpolations)
+                            for (auto waveform : waveforms)
+                                report(withFlangerDetails(makeResult("flanger", interpolationNames[interpolation], waveformNames[waveform],
+                                                                     sampleRate, blockSize,
+                                                                     measureFlanger(interpolation, waveform, oversampling, filter,
+                                                                                    sampleRate, blockSize, settings)),
+                                                          interpolation, oversampling, filter));
+
+                if (runBaselines)
+                {
+                    report(makeResult("juce::dsp::DelayLine", "linear", "sine", sampleRate, blockSize,
+                                      measureDelayLine<juce::dsp::DelayLineInterpolationTypes::Linear>(sampleRate, blockSize, settings)));
+                    report(makeResult("juce::dsp::DelayLine", "lagrange3rd", "sine", sampleRate, blockSize,
+                                      measureDelayLine<juce::dsp::DelayLineInterpolationTypes::Lagrange3rd>(sampleRate, blockSize, settings)));
+                    report(makeResult("juce::dsp::Chorus", "linear", "sine", sampleRate, blockSize,
+                                      measureChorus(sampleRate, blockSize, settings)));
+                }
+
+                // Between the lowest and highest tiers asked for, the largest resample they allow.
+                // Every block switches, so ns_per_block is what one switch costs the block it's in.
+                if (runTierSwitches)
+                {
+                    const int fromTier = oversamplings.getFirst(), toTier = oversamplings.getLast();
+                    const int filter = oversamplingFilters.getFirst();
+                    const auto m = measureTierSwitch(interpolations.getFirst(), waveforms.getFirst(), fromTier, toTier,
+                                                     filter, sampleRate, blockSize, settings);
+                    auto result = withFlangerDetails(makeResult("flanger tier switch", interpolationNames[interpolations.getFirst()],
+                                                                waveformNames[waveforms.getFirst()], sampleRate, blockSize, m),
+                                                     interpolations.getFirst(), toTier, filter);
+
+                    if (auto* object = result.getDynamicObject())
+                    {
+                        object->setProperty("oversampling", juce::String(oversamplingNames[fromTier]) + "<->"
+                                                            + oversamplingNames[toTier]);
+                        object->setProperty("ns_per_block", m.nsPerSample * blockSize);
+                    }
+
+                    report(result);
+                }
+            }
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("schema_version", 1);
+        root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("cpu_mhz", juce::SystemStats::getCpuSpeedInMegahertz());
+        root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+       #if JUCE_DEBUG
+        root->setProperty("build", "debug");
+       #else
+        root->setProperty("build", "release");
+       #endif
+        root->setProperty("channels", benchmarkChannels);
+        root->setProperty("samples_per_run", settings.samplesPerRun);
+        root->setProperty("repeats", settings.repeats);
+        root->setProperty("cycle_source", hasCycleCounter() ? "tsc" : "estimated");
+        root->setProperty("perf_counters", perfStatus);
+        root->setProperty("results", results);
+
+        const auto json = juce::JSON::toString(juce::var(root));
+
+        if (args.containsOption("--output|-o"))
+        {
+            const auto file = args.getFileForOption("--output|-o");
+
+            if (!file.replaceWithText(json))
+                juce::ConsoleApplication::fail("Couldn't write " + file.getFullPathName());
+        }
+        else
+        {
+            std::cout << json << std::endl;
+        }
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand("--help|-h", "Usage:", true);
+
+    app.addDefaultCommand({ "--run",
+                            "[--output=<file.json>] [--quick] [--samples=<n>] [--repeats=<n>] [--interpolation=linear,...] "
+                            "[--waveform=sine,...] [--oversampling=1x,...] [--oversampling-filter=iir,fir] [--block-sizes=1,...] [--sample-rates=44100,...] [--no-baselines] [--no-tier-switches] [--perf]",
+                            "Benchmarks processBlock and writes the results as JSON",
+                            "Times processBlock for every interpolation mode, waveform, oversampling tier, block size "
+                            "and sample rate (or the subsets given; oversampled tiers use the IIR filters unless "
+                            "--oversampling-filter says otherwise), plus juce::dsp::DelayLine and juce::dsp::Chorus baselines. Each "
+                            "result reports the median and minimum ns per sample frame over --repeats runs of "
+                            "--samples frames, and cycles per frame (TSC on x86, otherwise estimated from the clock). Unless "
+                            "--no-tier-switches is given, each block size and rate also times switching between the lowest "
+                            "and highest tier on every block, with the first interpolation mode and waveform. On Linux, "
+                            "--perf adds hardware counter events per frame (cycles, instructions, L1d/LLC misses, "
+                            "branch misses) to each result, or carries on without them if perf_event_open is refused.",
+                            runBenchmarks });
+
+    return app.findAndRunCommand(argc, argv);
+}
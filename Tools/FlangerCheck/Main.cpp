@@ -0,0 +1,930 @@
+/*
+  ==============================================================================
+
+    Correctness checks for optimised FlangerAudioProcessor kernels.
+
+    --golden      compares processBlock against the frozen scalar reference in
+                  ReferenceFlanger.h, with a per-interpolator error tolerance,
+                  and the LFO and interpolator tables against the functions
+                  they sample.
+    --partitions  checks that the output doesn't depend on how the host splits
+                  the audio into blocks, including across a silent gap the
+                  processor idles through, or on repreparing mid-session.
+    --realtime    runs processBlock, and parameter changes as host automation
+                  makes them, with allocation, lock and system call hooks
+                  armed (see RealtimeChecker.h).
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "RealtimeChecker.h"
+#include "ReferenceFlanger.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+    const char* const interpolationNames[] = { "linear", "quadratic", "cubic", "lagrange3", "lagrange5", "sinc8", "thiran" };
+    const char* const waveformNames[] = { "sine", "triangle", "square", "saw" };
+
+    // Largest absolute difference from the reference that an optimised kernel may
+    // produce, in any interpolation mode. Reordered float maths is expected to move
+    // the output by a few ulps, which feedback then amplifies.
+    const float goldenTolerance = 1.0e-4f;
+
+    // The same run split into different blocks should agree much more closely,
+    // since only per-block bookkeeping may differ.
+    const float partitionTolerance = 1.0e-5f;
+
+    static_assert(sizeof(interpolationNames) / sizeof(interpolationNames[0]) == FlangerKernel::kNumInterpolations,
+                  "Every interpolation mode needs a name");
+
+    // Largest difference of the sinc table from the directly evaluated windowed sinc
+    // (rounding to float, and normalising each row to unity gain at DC), and of the
+    // allpass table from its formula
+    const float sincTableTolerance = 1.0e-3f;
+    const float thiranTableTolerance = 1.0e-6f;
+
+    // Largest error of the interpolated LFO tables, indexed by FlangerAudioProcessor::Waves.
+    // Linear interpolation is exact on the triangle and least accurate on the
+    // tight curves of the smoothed square and saw edges.
+    const float lfoTolerance[] = { 1.0e-5f, 1.0e-5f, 1.0e-3f, 1.0e-3f };
+
+    // Largest difference a reprepare at a new rate may make to the output, against running at
+    // that rate all along. Resampling the delay line's few hundred Hz of audio should cost
+    // around 1e-4 at most; misplacing it by a fraction of a sample costs ten times that, and
+    // dropping it costs most of the wet signal.
+    const float resampleTolerance = 5.0e-4f;
+
+    // Largest error of the modulation stage's read positions, as a fraction of the delay.
+    // Working out the delay in float costs a couple of ulps of it; the single float
+    // position the split replaced was off by around a hundred times as much.
+    const float readPositionTolerance = 1.0e-6f;
+
+    constexpr int checkChannels = 2;
+
+    //==============================================================================
+    // A few partials plus a little noise: enough high frequency content to
+    // exercise the interpolators without being dominated by noise
+    juce::AudioBuffer<float> makeTestSignal(int numSamples, double sampleRate)
+    {
+        juce::AudioBuffer<float> signal(checkChannels, numSamples);
+        juce::Random random(0xf1a6);
+
+        for (int ch = 0; ch < checkChannels; ++ch)
+        {
+            auto* data = signal.getWritePointer(ch);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const double t = i / sampleRate;
+                data[i] = (float)(0.3 * std::sin(juce::MathConstants<double>::twoPi * (220.0 + 110.0 * ch) * t)
+                                  + 0.2 * std::sin(juce::MathConstants<double>::twoPi * 1000.0 * t)
+                                  + 0.1 * std::sin(juce::MathConstants<double>::twoPi * 3300.0 * t))
+                          + 0.01f * (random.nextFloat() * 2.0f - 1.0f);
+            }
+        }
+
+        return signal;
+    }
+
+    ReferenceParameters makeParameters(int interpolation, int waveform, bool stereo)
+    {
+        ReferenceParameters p;
+        p.interpolation = interpolation;
+        p.waveform = waveform;
+        p.stereo = stereo;
+        return p;
+    }
+
+    void setParameters(FlangerAudioProcessor& processor, const ReferenceParameters& p)
+    {
+        processor.setParameter(FlangerAudioProcessor::kDelayParam, p.delayMs);
+        processor.setParameter(FlangerAudioProcessor::kSweepParam, p.sweepMs);
+        processor.setParameter(FlangerAudioProcessor::kDepthParam, p.depth);
+        processor.setParameter(FlangerAudioProcessor::kFbParam, p.feedback);
+        processor.setParameter(FlangerAudioProcessor::kFrequencyParam, p.frequency);
+        processor.setParameter(FlangerAudioProcessor::kWaveParam, (float)p.waveform);
+        processor.setParameter(FlangerAudioProcessor::kInterpolParam, (float)p.interpolation);
+        processor.setParameter(FlangerAudioProcessor::kStereoParam, p.stereo ? 1.0f : 0.0f);
+    }
+
+    // Processes input through a freshly prepared FlangerAudioProcessor, cycling
+    // through blockSizes to decide how the buffer is split. The parameters are set
+    // before prepareToPlay, so they start out at their values instead of gliding
+    // there. If automation is given, the parameters change to it halfway through,
+    // where a block always starts, and glide there. The reference has no
+    // oversampling, so only the partition checks set it. With SampleType double,
+    // the processor runs in double precision on a converted copy of the input.
+    template <typename SampleType = float>
+    juce::AudioBuffer<float> runProcessor(const ReferenceParameters& p, double sampleRate,
+                                          const juce::AudioBuffer<float>& input, const std::vector<int>& blockSizes,
+                                          int oversampling = FlangerAudioProcessor::kOversampling1x,
+                                          int oversamplingFilter = FlangerAudioProcessor::kPolyphaseIIR,
+                                          const ReferenceParameters* automation = nullptr)
+    {
+        const int maxBlockSize = *std::max_element(blockSizes.begin(), blockSizes.end());
+
+        FlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(checkChannels, checkChannels, sampleRate, maxBlockSize);
+        processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? juce::AudioProcessor::doublePrecision
+                                                                                  : juce::AudioProcessor::singlePrecision);
+
+        setParameters(processor, p);
+        processor.setParameter(FlangerAudioProcessor::kOversamplingParam, (float)oversampling);
+        processor.setParameter(FlangerAudioProcessor::kOversamplingFilterParam, (float)oversamplingFilter);
+
+        processor.prepareToPlay(sampleRate, maxBlockSize);
+
+        juce::AudioBuffer<SampleType> output;
+        output.makeCopyOf(input);
+
+        juce::MidiBuffer midi;
+        size_t nextBlock = 0;
+        const int automationPosition = automation != nullptr ? output.getNumSamples() / 2 : -1;
+
+        for (int position = 0; position < output.getNumSamples();)
+        {
+            if (position == automationPosition)
+                setParameters(processor, *automation);
+
+            int numSamples = juce::jmin(blockSizes[nextBlock], output.getNumSamples() - position);
+            nextBlock = (nextBlock + 1) % blockSizes.size();
+
+            if (position < automationPosition)
+                numSamples = juce::jmin(numSamples, automationPosition - position);
+
+            juce::AudioBuffer<SampleType> block(output.getArrayOfWritePointers(), checkChannels, position, numSamples);
+            processor.processBlock(block, midi);
+            position += numSamples;
+        }
+
+        processor.releaseResources();
+
+        juce::AudioBuffer<float> result;
+        result.makeCopyOf(output);
+        return result;
+    }
+
+    juce::AudioBuffer<float> runReference(const ReferenceParameters& p, double sampleRate,
+                                          const juce::AudioBuffer<float>& input, int blockSize)
+    {
+        ReferenceFlanger reference;
+        reference.prepare(sampleRate);
+
+        juce::AudioBuffer<float> output(input);
+
+        for (int position = 0; position < output.getNumSamples(); position += blockSize)
+        {
+            float* channels[checkChannels];
+
+            for (int ch = 0; ch < checkChannels; ++ch)
+                channels[ch] = output.getWritePointer(ch, position);
+
+            reference.process(channels, checkChannels, juce::jmin(blockSize, output.getNumSamples() - position), p);
+        }
+
+        return output;
+    }
+
+    float maxAbsDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        float maxDifference = 0.0f;
+
+        for (int ch = 0; ch < a.getNumChannels(); ++ch)
+        {
+            for (int i = 0; i < a.getNumSamples(); ++i)
+            {
+                const float x = a.getSample(ch, i);
+                const float y = b.getSample(ch, i);
+
+                // A kernel that goes non-finite only matches the reference if it does so on
+                // exactly the same samples
+                if (std::isfinite(x) != std::isfinite(y))
+                    return std::numeric_limits<float>::infinity();
+
+                if (std::isfinite(x))
+                    maxDifference = juce::jmax(maxDifference, std::abs(x - y));
+            }
+        }
+
+        return maxDifference;
+    }
+
+    //==============================================================================
+    struct CheckResults
+    {
+        int numRun = 0;
+        int numFailed = 0;
+
+        void add(const juce::String& name, bool passed, const juce::String& details)
+        {
+            ++numRun;
+            if (!passed)
+                ++numFailed;
+
+            std::cout << (passed ? "  ok    " : "  FAIL  ") << name << ": " << details << std::endl;
+        }
+
+        void add(const juce::String& name, float error, float tolerance)
+        {
+            add(name, error <= tolerance,
+                "max error " + juce::String(error) + " (tolerance " + juce::String(tolerance) + ")");
+        }
+    };
+
+    juce::Array<int> parseSampleRates(const juce::ArgumentList& args)
+    {
+        if (!args.containsOption("--sample-rates"))
+            return { 44100, 96000 };
+
+        juce::Array<int> sampleRates;
+
+        for (auto& token : juce::StringArray::fromTokens(args.getValueForOption("--sample-rates"), ",", {}))
+            sampleRates.add(token.getIntValue());
+
+        return sampleRates;
+    }
+
+    template <typename CheckFn>
+    void forEachConfiguration(const juce::ArgumentList& args, CheckFn&& check)
+    {
+        for (auto sampleRate : parseSampleRates(args))
+            for (int interpolation = 0; interpolation < FlangerKernel::kNumInterpolations; ++interpolation)
+                for (int waveform = 0; waveform < 4; ++waveform)
+                    for (int stereo = 0; stereo < 2; ++stereo)
+                        check(makeParameters(interpolation, waveform, stereo != 0), (double)sampleRate,
+                              juce::String(interpolationNames[interpolation]) + " " + waveformNames[waveform]
+                              + (stereo != 0 ? " stereo " : " mono ") + juce::String(sampleRate) + " Hz");
+    }
+
+    void checkLfoTables(CheckResults& results)
+    {
+        std::cout << "LFO tables:" << std::endl;
+
+        for (int waveform = 0; waveform < 4; ++waveform)
+        {
+            const float* table = FlangerLfo::getTable(waveform);
+            float error = 0.0f;
+
+            // Steps through the cycle at an odd stride, so every table segment is hit at many fractions
+            for (juce::uint32 i = 0, phase = 0; i < (1u << 20); ++i, phase += 0x3003u)
+            {
+                const double expected = ReferenceFlanger::lfo((double)phase / 4294967296.0, waveform);
+                error = juce::jmax(error, (float)std::abs(FlangerLfo::lookup(table, phase) - expected));
+            }
+
+            results.add(juce::String(waveformNames[waveform]), error, lfoTolerance[waveform]);
+        }
+    }
+
+    void checkInterpolatorTables(CheckResults& results)
+    {
+        std::cout << "Interpolator tables:" << std::endl;
+
+        float sincError = 0.0f, thiranError = 0.0f;
+
+        for (int phase = 0; phase <= FlangerKernel::kPhases; ++phase)
+        {
+            const double fraction = (double)phase / FlangerKernel::kPhases;
+            const float* row = FlangerKernel::SincInterpolator::getCoefficients(phase);
+
+            for (int tap = 0; tap < FlangerKernel::SincInterpolator::kNumTaps; ++tap)
+            {
+                const double t = tap - FlangerKernel::SincInterpolator::kTapsBefore - fraction;
+                const double expected = ReferenceFlanger::sinc(t) * ReferenceFlanger::kaiser(t, 4.0, 6.0);
+                sincError = juce::jmax(sincError, (float)std::abs(row[tap] - expected));
+            }
+
+            const double delay = phase < FlangerKernel::kPhases / 2 ? 1.0 - fraction : 2.0 - fraction;
+            thiranError = juce::jmax(thiranError, (float)std::abs(FlangerKernel::detail::thiranTable.coefficients[phase]
+                                                                  - (1.0 - delay) / (1.0 + delay)));
+        }
+
+        results.add("sinc8", sincError, sincTableTolerance);
+        results.add("thiran", thiranError, thiranTableTolerance);
+    }
+
+    // The kernels and ReferenceFlanger both take the read position as a whole sample index
+    // plus a fraction, so neither can catch a mistake in that split. This checks
+    // FlangerModulation's against the position worked out in double from the same delay.
+    void checkReadPositions(const juce::ArgumentList& args, CheckResults& results)
+    {
+        std::cout << "Read positions:" << std::endl;
+
+        constexpr int blockSize = 4096;
+
+        for (auto sampleRate : parseSampleRates(args))
+        {
+            int length = 1;
+
+            while (length < 2 * sampleRate)
+                length *= 2;
+
+            FlangerModulation modulation;
+            FlangerScratchArena arena;
+            modulation.prepare(blockSize);
+            arena.prepare(FlangerModulation::getScratchSize(blockSize));
+
+            for (int waveform = 0; waveform < 4; ++waveform)
+            {
+                FlangerModulation::Settings settings;
+                settings.delayMs = 25.0f;
+                settings.sweepMs = 0.7f;
+                settings.samplesPerMs = (float)(sampleRate * 0.001);
+                settings.lfoTable = FlangerLfo::getTable(waveform);
+                settings.phaseIncrement = FlangerLfo::getPhaseIncrement(5.0, 1.0 / sampleRate);
+                settings.delayMask = length - 1;
+
+                // Starting near the end of the buffer, where a float position was coarsest
+                FlangerLfo::Phase phase = 0x12345678u;
+                int writePosition = length - 1000;
+                double error = 0.0;
+
+                for (int block = 0; block < 64; ++block)
+                {
+                    arena.reset();
+                    modulation.prepareBlock(arena, blockSize);
+                    const auto trajectory = modulation.compute(0, phase, writePosition, blockSize, settings);
+
+                    for (int i = 0; i < blockSize; ++i)
+                    {
+                        const float lfo = FlangerLfo::lookup(settings.lfoTable, phase + (FlangerLfo::Phase)i * settings.phaseIncrement);
+                        const double delay = ((double)settings.delayMs + (double)settings.sweepMs * lfo) * settings.samplesPerMs;
+                        double difference = trajectory.index[i] + (double)trajectory.fraction[i] - (writePosition + i - delay);
+
+                        difference -= length * std::round(difference / length);
+                        error = juce::jmax(error, std::abs(difference) / delay);
+                    }
+
+                    phase = FlangerModulation::advance(phase, blockSize, settings);
+                    writePosition = (writePosition + blockSize) & settings.delayMask;
+                }
+
+                results.add(juce::String(waveformNames[waveform]) + " " + juce::String(sampleRate) + " Hz", (float)error,
+                            readPositionTolerance);
+            }
+        }
+    }
+
+    void checkGolden(const juce::ArgumentList& args, CheckResults& results)
+    {
+        checkLfoTables(results);
+        checkInterpolatorTables(results);
+        checkReadPositions(args, results);
+
+        std::cout << "Golden reference:" << std::endl;
+
+        forEachConfiguration(args, [&](const ReferenceParameters& p, double sampleRate, const juce::String& name)
+        {
+            const auto input = makeTestSignal((int)sampleRate, sampleRate);
+            const auto expected = runReference(p, sampleRate, input, 512);
+            const auto actual = runProcessor(p, sampleRate, input, { 512 });
+
+            results.add(name, maxAbsDifference(expected, actual), goldenTolerance);
+
+            // The double kernels are the same code, so they should match the reference just as well
+            results.add(name + " double", maxAbsDifference(expected, runProcessor<double>(p, sampleRate, input, { 512 })),
+                        goldenTolerance);
+        });
+    }
+
+    void checkPartitions(const juce::ArgumentList& args, CheckResults& results)
+    {
+        std::cout << "Block partition invariance:" << std::endl;
+
+        forEachConfiguration(args, [&](const ReferenceParameters& p, double sampleRate, const juce::String& name)
+        {
+            const auto input = makeTestSignal(4 * 4096, sampleRate);
+            const auto expected = runProcessor(p, sampleRate, input, { 4096 });
+
+            results.add(name + ", 1-sample blocks", maxAbsDifference(expected, runProcessor(p, sampleRate, input, { 1 })),
+                        partitionTolerance);
+
+            // Random sizes, biased towards small blocks the way hosts split around automation and loop points
+            for (int seed = 1; seed <= 3; ++seed)
+            {
+                juce::Random random(seed);
+                std::vector<int> blockSizes;
+
+                for (int total = 0; total < input.getNumSamples(); total += blockSizes.back())
+                    blockSizes.push_back(1 + random.nextInt(1 << random.nextInt(13)));
+
+                results.add(name + ", random blocks #" + juce::String(seed),
+                            maxAbsDifference(expected, runProcessor(p, sampleRate, input, blockSizes)),
+                            partitionTolerance);
+            }
+        });
+
+        // The oversampling filters keep their state across blocks, so they shouldn't depend on
+        // the split either
+        const char* const filterNames[] = { "IIR", "FIR" };
+
+        for (auto sampleRate : parseSampleRates(args))
+        {
+            for (int tier = FlangerAudioProcessor::kOversampling2x; tier < FlangerAudioProcessor::kNumOversamplingTiers; ++tier)
+            {
+                for (int filter = 0; filter < FlangerAudioProcessor::kNumOversamplingFilters; ++filter)
+                {
+                    const auto p = makeParameters(FlangerAudioProcessor::kCubic, FlangerAudioProcessor::kSawWave, true);
+                    const auto input = makeTestSignal(4 * 4096, sampleRate);
+                    const auto expected = runProcessor(p, sampleRate, input, { 4096 }, tier, filter);
+                    const auto name = juce::String(1 << tier) + "x " + filterNames[filter] + " " + juce::String(sampleRate) + " Hz";
+
+                    results.add(name + ", 1-sample blocks",
+                                maxAbsDifference(expected, runProcessor(p, sampleRate, input, { 1 }, tier, filter)),
+                                partitionTolerance);
+                    results.add(name + ", 1000-sample blocks",
+                                maxAbsDifference(expected, runProcessor(p, sampleRate, input, { 1000 }, tier, filter)),
+                                partitionTolerance);
+                }
+            }
+        }
+
+        // Every continuous parameter jumps halfway through, so the smoothers ramp it over
+        // the following blocks, through the kernels that read ramps. How far a ramp has got
+        // shouldn't depend on the split.
+        forEachConfiguration(args, [&](const ReferenceParameters& p, double sampleRate, const juce::String& name)
+        {
+            if (p.waveform != FlangerAudioProcessor::kSineWave)
+                return;
+
+            auto automation = p;
+            automation.delayMs = 8.0f;
+            automation.sweepMs = 0.2f;
+            automation.depth = 0.5f;
+            automation.feedback = 0.3f;
+            automation.frequency = 1.5f;
+
+            const auto input = makeTestSignal(4 * 4096, sampleRate);
+            const auto expected = runProcessor(p, sampleRate, input, { 4096 }, FlangerAudioProcessor::kOversampling1x,
+                                               FlangerAudioProcessor::kPolyphaseIIR, &automation);
+
+            results.add(name + " automated, 1-sample blocks",
+                        maxAbsDifference(expected, runProcessor(p, sampleRate, input, { 1 }, FlangerAudioProcessor::kOversampling1x,
+                                                                FlangerAudioProcessor::kPolyphaseIIR, &automation)),
+                        partitionTolerance);
+            results.add(name + " automated, 100-sample blocks",
+                        maxAbsDifference(expected, runProcessor(p, sampleRate, input, { 100 }, FlangerAudioProcessor::kOversampling1x,
+                                                                FlangerAudioProcessor::kPolyphaseIIR, &automation)),
+                        partitionTolerance);
+        });
+
+        // A gap in the input lets the processor go idle once the delay line has decayed, and
+        // come back when the signal does. How far into the gap that happens depends on the
+        // split, but only by what was left below the silence threshold.
+        for (auto sampleRate : parseSampleRates(args))
+        {
+            const auto p = makeParameters(FlangerAudioProcessor::kCubic, FlangerAudioProcessor::kSineWave, true);
+            const auto signal = makeTestSignal(4 * 4096, sampleRate);
+            const int signalLength = signal.getNumSamples();
+            const int gapLength = (int)(2 * sampleRate);
+
+            juce::AudioBuffer<float> input(checkChannels, 2 * signalLength + gapLength);
+            input.clear();
+
+            for (int ch = 0; ch < checkChannels; ++ch)
+            {
+                input.copyFrom(ch, 0, signal, ch, 0, signalLength);
+                input.copyFrom(ch, signalLength + gapLength, signal, ch, 0, signalLength);
+            }
+
+            const auto name = "silent gap " + juce::String(sampleRate) + " Hz";
+            const auto expected = runProcessor(p, sampleRate, input, { 4096 });
+            const auto split = runProcessor(p, sampleRate, input, { 1 });
+
+            // Idle blocks leave the silent input as it is, so by the end of the gap the
+            // output is exactly zero
+            const auto endsSilent = [&](const juce::AudioBuffer<float>& output)
+            {
+                const int end = signalLength + gapLength;
+                const int start = end - gapLength / 4;
+
+                for (int ch = 0; ch < checkChannels; ++ch)
+                    if (output.findMinMax(ch, start, end - start) != juce::Range<float>())
+                        return false;
+
+                return true;
+            };
+
+            const bool idled = endsSilent(expected) && endsSilent(split);
+
+            results.add(name + ", goes idle", idled, idled ? "the end of the gap is silent" : "the end of the gap is not silent");
+            results.add(name + ", 1-sample blocks", maxAbsDifference(expected, split),
+                        partitionTolerance + 2.0f * FlangerAudioProcessor::kSilenceThreshold);
+        }
+
+        // Hosts reprepare mid-session when the device or its block size changes. At the same
+        // rate, the delay line's audio and the LFO carry over unchanged, so the output should
+        // carry on as if nothing had happened.
+        for (auto sampleRate : parseSampleRates(args))
+        {
+            const auto p = makeParameters(FlangerAudioProcessor::kCubic, FlangerAudioProcessor::kSineWave, true);
+            const auto input = makeTestSignal(4 * 4096, sampleRate);
+            const auto expected = runProcessor(p, sampleRate, input, { 4096 });
+
+            FlangerAudioProcessor processor;
+            processor.setPlayConfigDetails(checkChannels, checkChannels, sampleRate, 4096);
+            setParameters(processor, p);
+            processor.prepareToPlay(sampleRate, 4096);
+
+            juce::AudioBuffer<float> output;
+            output.makeCopyOf(input);
+            juce::MidiBuffer midi;
+
+            for (int position = 0; position < output.getNumSamples(); position += 4096)
+            {
+                if (position == 2 * 4096)
+                    processor.prepareToPlay(sampleRate, 1024);
+
+                juce::AudioBuffer<float> block(output.getArrayOfWritePointers(), checkChannels, position, 4096);
+                processor.processBlock(block, midi);
+            }
+
+            results.add("reprepared " + juce::String(sampleRate) + " Hz", maxAbsDifference(expected, output),
+                        partitionTolerance);
+        }
+
+        // At a different rate the delay line's audio is resampled rather than dropped, so the
+        // output should carry on without a jump: no step across the reprepare bigger than the
+        // largest one anywhere else. Beyond that, it should carry on the way it would have if
+        // it had been running at the new rate all along. The input is a pair of sines, faded
+        // in so their onset sounds the same at either rate, that carry on through the change,
+        // and the reprepare falls where both rates have a sample.
+        for (auto sampleRate : parseSampleRates(args))
+        {
+            const int newRate = sampleRate == 48000 ? 44100 : 48000;
+            const int blockSize = 1024;
+            const auto p = makeParameters(FlangerAudioProcessor::kCubic, FlangerAudioProcessor::kSineWave, true);
+
+            int boundary = 4 * blockSize;
+
+            while ((juce::int64)boundary * newRate % sampleRate != 0)
+                ++boundary;
+
+            const int newBoundary = (int)((juce::int64)boundary * newRate / sampleRate);
+
+            const auto getInput = [](int ch, double t)
+            {
+                const double fadeIn = t < 0.01 ? 0.5 - 0.5 * std::cos(juce::MathConstants<double>::pi * t / 0.01) : 1.0;
+                return (float)(0.5 * fadeIn * std::sin(juce::MathConstants<double>::twoPi * (220.0 + 110.0 * ch) * t));
+            };
+
+            const auto render = [&](juce::AudioBuffer<float>& output, double firstRate, int reprepareAt, double secondRate)
+            {
+                for (int ch = 0; ch < checkChannels; ++ch)
+                    for (int i = 0; i < output.getNumSamples(); ++i)
+                        output.setSample(ch, i, getInput(ch, i < reprepareAt ? i / firstRate
+                                                                             : reprepareAt / firstRate + (i - reprepareAt) / secondRate));
+
+                FlangerAudioProcessor processor;
+                processor.setPlayConfigDetails(checkChannels, checkChannels, firstRate, blockSize);
+                setParameters(processor, p);
+                processor.prepareToPlay(firstRate, blockSize);
+
+                juce::MidiBuffer midi;
+
+                for (int position = 0; position < output.getNumSamples();)
+                {
+                    if (position == reprepareAt)
+                    {
+                        processor.setRateAndBufferSizeDetails(secondRate, blockSize);
+                        processor.prepareToPlay(secondRate, blockSize);
+                    }
+
+                    int numSamples = juce::jmin(blockSize, output.getNumSamples() - position);
+
+                    if (position < reprepareAt)
+                        numSamples = juce::jmin(numSamples, reprepareAt - position);
+
+                    juce::AudioBuffer<float> block(output.getArrayOfWritePointers(), checkChannels, position, numSamples);
+                    processor.processBlock(block, midi);
+                    position += numSamples;
+                }
+            };
+
+            juce::AudioBuffer<float> output(checkChannels, 2 * boundary);
+            render(output, sampleRate, boundary, newRate);
+
+            // The same input, at the new rate from the start
+            juce::AudioBuffer<float> expected(checkChannels, newBoundary + boundary);
+            render(expected, newRate, -1, newRate);
+
+            // The first block is left out, while the delay line fills up
+            float steadyStep = 0.0f;
+            float boundaryStep = 0.0f;
+            float difference = 0.0f;
+
+            for (int ch = 0; ch < checkChannels; ++ch)
+            {
+                for (int i = blockSize; i < output.getNumSamples(); ++i)
+                {
+                    const float step = std::abs(output.getSample(ch, i) - output.getSample(ch, i - 1));
+                    auto& largest = i >= boundary && i < boundary + 64 ? boundaryStep : steadyStep;
+                    largest = juce::jmax(largest, step);
+                }
+
+                for (int i = 0; i < boundary; ++i)
+                    difference = juce::jmax(difference, std::abs(output.getSample(ch, boundary + i)
+                                                                 - expected.getSample(ch, newBoundary + i)));
+            }
+
+            const auto name = "reprepared " + juce::String(sampleRate) + " Hz to " + juce::String(newRate) + " Hz";
+
+            results.add(name, boundaryStep <= steadyStep,
+                        "largest step " + juce::String(boundaryStep) + " across the reprepare, "
+                            + juce::String(steadyStep) + " elsewhere");
+            results.add(name + ", against " + juce::String(newRate) + " Hz throughout", difference, resampleTolerance);
+        }
+    }
+
+    //==============================================================================
+    // The ranges the editor exposes for each FlangerAudioProcessor::Parameters entry
+    const float parameterRanges[][2] = {
+        { 5.0f, 25.0f },  // delay
+        { 0.0f, 1.0f },   // sweep width
+        { 0.0f, 1.0f },   // depth
+        { 0.0f, 1.0f },   // wet
+        { 0.0f, 3.0f },   // waveform
+        { 0.0f, 6.0f },   // interpolation
+        { 0.0f, 0.99f },  // feedback
+        { 0.0f, 10.0f },  // frequency
+        { 0.0f, 1.0f },   // stereo
+        { 0.0f, 3.0f },   // oversampling
+        { 0.0f, 1.0f }    // oversampling filter
+    };
+
+    static_assert(sizeof(parameterRanges) / sizeof(parameterRanges[0]) == FlangerAudioProcessor::kNumParameters,
+                  "Every parameter needs a range to sweep");
+
+    // Drives a processor the way a host would, with only processBlock armed:
+    // everything else (parameter changes from the editor, prepareToPlay,
+    // state restore) runs on the "message thread" between blocks.
+    class RealtimeScenario
+    {
+    public:
+        RealtimeScenario() : input(makeTestSignal(8192, 48000.0)) {}
+
+        void prepare(int numChannels, double sampleRate, int maxBlockSize)
+        {
+            processor.releaseResources();
+            processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, maxBlockSize);
+            processor.prepareToPlay(sampleRate, maxBlockSize);
+            buffer.setSize(numChannels, maxBlockSize);
+        }
+
+        // As a host does when the device changes rate mid-session: no release, and the
+        // delay line's audio carries over
+        void reprepare(double sampleRate, int maxBlockSize)
+        {
+            processor.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+            processor.prepareToPlay(sampleRate, maxBlockSize);
+            buffer.setSize(buffer.getNumChannels(), maxBlockSize);
+        }
+
+        void processBlocks(int numBlocks, int blockSize)
+        {
+            juce::MidiBuffer midi;
+
+            for (int i = 0; i < numBlocks; ++i)
+            {
+                juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), blockSize);
+
+                for (int ch = 0; ch < block.getNumChannels(); ++ch)
+                    block.copyFrom(ch, 0, input, ch, (i * blockSize) % (input.getNumSamples() - blockSize), blockSize);
+
+                RealtimeChecker::ScopedRealtimeSection armed("FlangerAudioProcessor::processBlock");
+                processor.processBlock(block, midi);
+            }
+        }
+
+        FlangerAudioProcessor processor;
+
+    private:
+        juce::AudioBuffer<float> input, buffer;
+    };
+
+    void checkRealtimeSafety(CheckResults& results)
+    {
+        std::cout << "Real-time safety:" << std::endl;
+
+        if (!RealtimeChecker::canCheckSystemCalls())
+            std::cout << "  (only operator new/delete can be hooked on this platform)" << std::endl;
+
+        auto check = [&results](const juce::String& name, const std::function<void(RealtimeScenario&)>& scenario)
+        {
+            RealtimeScenario s;
+            const int violationsBefore = RealtimeChecker::getNumViolations();
+            scenario(s);
+            const int violations = RealtimeChecker::getNumViolations() - violationsBefore;
+
+            results.add(name, violations == 0, juce::String(violations) + " violations");
+        };
+
+        check("steady state", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 48000.0, 512);
+            s.processBlocks(200, 512);
+        });
+
+        check("parameter changes", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 48000.0, 512);
+
+            for (int index = 0; index < FlangerAudioProcessor::kNumParameters; ++index)
+            {
+                for (int step = 0; step <= 4; ++step)
+                {
+                    const auto& range = parameterRanges[index];
+                    auto value = range[0] + (range[1] - range[0]) * (float)step / 4.0f;
+
+                    if (index == FlangerAudioProcessor::kWaveParam || index == FlangerAudioProcessor::kInterpolParam
+                        || index == FlangerAudioProcessor::kStereoParam || index == FlangerAudioProcessor::kOversamplingParam
+                        || index == FlangerAudioProcessor::kOversamplingFilterParam)
+                        value = std::round(value);
+
+                    s.processor.setParameter(index, value);
+                    s.processBlocks(4, 512);
+                }
+            }
+        });
+
+        check("prepare/release cycles", [](RealtimeScenario& s)
+        {
+            for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0, 44100.0 })
+            {
+                for (auto maxBlockSize : { 64, 512, 2048 })
+                {
+                    s.prepare(2, sampleRate, maxBlockSize);
+                    s.processBlocks(8, maxBlockSize);
+                    s.processBlocks(8, juce::jmax(1, maxBlockSize / 3));
+                }
+            }
+
+            s.prepare(1, 48000.0, 512);
+            s.processBlocks(8, 512);
+        });
+
+        // Automation from the audio thread, oversampling included, which changes the latency
+        // and switches tiers at the next block. The host only hears about it later, from the
+        // message thread.
+        check("automated oversampling", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 48000.0, 512);
+
+            for (int step = 0; step < 16; ++step)
+            {
+                {
+                    RealtimeChecker::ScopedRealtimeSection armed("FlangerAudioProcessor::automateParameter");
+                    s.processor.automateParameter(FlangerAudioProcessor::kOversamplingParam,
+                                                  (float)(step % FlangerAudioProcessor::kNumOversamplingTiers));
+                    s.processor.automateParameter(FlangerAudioProcessor::kOversamplingFilterParam,
+                                                  (float)(step / FlangerAudioProcessor::kNumOversamplingTiers % 2));
+                }
+
+                s.processBlocks(4, 512);
+            }
+        });
+
+        // Only processBlock is armed: prepareToPlay may allocate while it resamples the delay
+        // line's audio to the new rate, but the blocks after it mustn't, oversampled or not
+        check("rate change reprepares", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 44100.0, 512);
+
+            for (int tier : { FlangerAudioProcessor::kOversampling1x, FlangerAudioProcessor::kOversampling4x })
+            {
+                s.processor.setParameter(FlangerAudioProcessor::kOversamplingParam, (float)tier);
+
+                for (auto sampleRate : { 48000.0, 96000.0, 44100.0 })
+                {
+                    s.processBlocks(16, 512);
+                    s.reprepare(sampleRate, 512);
+                }
+            }
+
+            s.processBlocks(16, 512);
+        });
+
+        // A host switching precision prepares again without a release, into an engine that
+        // has never held any audio, and may then switch back
+        check("precision switches", [](RealtimeScenario& s)
+        {
+            s.prepare(1, 48000.0, 512);
+            s.processBlocks(16, 512);
+
+            for (auto precision : { juce::AudioProcessor::doublePrecision, juce::AudioProcessor::singlePrecision })
+            {
+                s.processor.setProcessingPrecision(precision);
+                s.reprepare(48000.0, 512);
+            }
+
+            s.processBlocks(16, 512);
+        });
+
+        // Hosts may reset on the audio thread when the transport jumps or loops
+        check("resets", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 48000.0, 512);
+
+            for (int i = 0; i < 8; ++i)
+            {
+                s.processBlocks(4, 512);
+
+                RealtimeChecker::ScopedRealtimeSection armed("FlangerAudioProcessor::reset");
+                s.processor.reset();
+            }
+        });
+
+        check("state restore", [](RealtimeScenario& s)
+        {
+            s.prepare(2, 48000.0, 512);
+            s.processBlocks(8, 512);
+
+            juce::MemoryBlock state;
+            s.processor.getStateInformation(state);
+            s.processor.setParameter(FlangerAudioProcessor::kInterpolParam, FlangerAudioProcessor::kCubic);
+            s.processor.setStateInformation(state.getData(), (int)state.getSize());
+            s.processBlocks(8, 512);
+        });
+    }
+
+    void finish(const CheckResults& results)
+    {
+        std::cout << results.numRun - results.numFailed << " of " << results.numRun << " checks passed" << std::endl;
+
+        if (results.numFailed > 0)
+            juce::ConsoleApplication::fail(juce::String(results.numFailed) + " checks failed");
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand("--help|-h", "Usage:", true);
+
+    app.addCommand({ "--golden",
+                     "--golden [--sample-rates=44100,...]",
+                     "Compares processBlock against the frozen scalar reference",
+                     "Runs every interpolation mode, waveform and mono/stereo setting through both "
+                     "FlangerAudioProcessor, in single and double precision, and ReferenceFlanger, and "
+                     "fails if any output sample differs by more than the interpolator's tolerance. Also "
+                     "checks the LFO and interpolator tables against the functions they sample.",
+                     [](const juce::ArgumentList& args)
+                     {
+                         CheckResults results;
+                         checkGolden(args, results);
+                         finish(results);
+                     } });
+
+    app.addCommand({ "--partitions",
+                     "--partitions [--sample-rates=44100,...]",
+                     "Checks that output doesn't depend on the host's block sizes",
+                     "Compares processing in 4096-sample blocks against 1-sample blocks and several random "
+                     "partitions of the same input.",
+                     [](const juce::ArgumentList& args)
+                     {
+                         CheckResults results;
+                         checkPartitions(args, results);
+                         finish(results);
+                     } });
+
+    app.addCommand({ "--realtime",
+                     "--realtime",
+                     "Checks processBlock for allocations, locks and system calls",
+                     "Arms the real-time checker around every processBlock call while driving the processor "
+                     "through parameter changes, prepareToPlay/releaseResources cycles and state restore, and "
+                     "fails with a stack trace for every allocation, lock or blocking system call it sees.",
+                     [](const juce::ArgumentList&)
+                     {
+                         CheckResults results;
+                         checkRealtimeSafety(results);
+                         finish(results);
+                     } });
+
+    app.addDefaultCommand({ "--all",
+                            "[--sample-rates=44100,...]",
+                            "Runs every check",
+                            {},
+                            [](const juce::ArgumentList& args)
+                            {
+                                CheckResults results;
+                                checkGolden(args, results);
+                                checkPartitions(args, results);
+                                checkRealtimeSafety(results);
+                                finish(results);
+                            } });
+
+    return app.findAndRunCommand(argc, argv);
+}
@@ -0,0 +1,289 @@
+/*
+  ==============================================================================
+
+    Real-time safety checker for the audio thread.
+
+  ==============================================================================
+*/
+
+#include "RealtimeChecker.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__linux__) && defined(__GLIBC__)
+ #define FLANGER_RT_CHECK_INTERPOSE 1
+ #include <dlfcn.h>
+ #include <execinfo.h>
+ #include <pthread.h>
+ #include <sched.h>
+ #include <time.h>
+ #include <unistd.h>
+#else
+ #define FLANGER_RT_CHECK_INTERPOSE 0
+#endif
+
+namespace
+{
+    // The description of the innermost armed section, or nullptr when the thread isn't checked
+    thread_local const char* armedSection = nullptr;
+    std::atomic<int> numViolations { 0 };
+
+    void printStackTrace()
+    {
+       #if FLANGER_RT_CHECK_INTERPOSE
+        void* frames[64];
+        const int numFrames = backtrace(frames, 64);
+        backtrace_symbols_fd(frames, numFrames, 2);
+       #endif
+    }
+
+    // Called from inside the hooks. Disarms the thread while reporting, since
+    // printing a stack trace is anything but real-time safe itself.
+    void checkRealtime(const char* what)
+    {
+        const char* section = armedSection;
+
+        if (section == nullptr)
+            return;
+
+        armedSection = nullptr;
+        ++numViolations;
+
+        std::fprintf(stderr, "Real-time violation: %s called during %s\n", what, section);
+        printStackTrace();
+        std::fputc('\n', stderr);
+
+        armedSection = section;
+    }
+
+   #if FLANGER_RT_CHECK_INTERPOSE
+    template <typename Function>
+    Function findNext(const char* name)
+    {
+        return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+    }
+
+    using MutexFunction = int (*)(pthread_mutex_t*);
+    using CondWaitFunction = int (*)(pthread_cond_t*, pthread_mutex_t*);
+    using CondTimedWaitFunction = int (*)(pthread_cond_t*, pthread_mutex_t*, const struct timespec*);
+    using ReadFunction = ssize_t (*)(int, void*, size_t);
+    using WriteFunction = ssize_t (*)(int, const void*, size_t);
+    using CloseFunction = int (*)(int);
+    using NanosleepFunction = int (*)(const struct timespec*, struct timespec*);
+    using UsleepFunction = int (*)(useconds_t);
+    using YieldFunction = int (*)();
+
+    // Resolved once before main() runs, so the hooks never call dlsym (which can allocate) on a checked thread
+    struct NextFunctions
+    {
+        MutexFunction mutexLock = findNext<MutexFunction>("pthread_mutex_lock");
+        MutexFunction mutexTryLock = findNext<MutexFunction>("pthread_mutex_trylock");
+        CondWaitFunction condWait = findNext<CondWaitFunction>("pthread_cond_wait");
+        CondTimedWaitFunction condTimedWait = findNext<CondTimedWaitFunction>("pthread_cond_timedwait");
+        ReadFunction read = findNext<ReadFunction>("read");
+        WriteFunction write = findNext<WriteFunction>("write");
+        CloseFunction close = findNext<CloseFunction>("close");
+        NanosleepFunction nanosleep = findNext<NanosleepFunction>("nanosleep");
+        UsleepFunction usleep = findNext<UsleepFunction>("usleep");
+        YieldFunction sched_yield = findNext<YieldFunction>("sched_yield");
+    };
+
+    const NextFunctions& next()
+    {
+        static const NextFunctions functions;
+        return functions;
+    }
+
+    // backtrace() loads libgcc lazily on its first call, which allocates
+    const struct Initialiser
+    {
+        Initialiser()
+        {
+            next();
+            void* frame;
+            backtrace(&frame, 1);
+        }
+    } initialiser;
+   #endif
+}
+
+//==============================================================================
+namespace RealtimeChecker
+{
+    ScopedRealtimeSection::ScopedRealtimeSection(const char* description)
+        : previousDescription(armedSection)
+    {
+        armedSection = description;
+    }
+
+    ScopedRealtimeSection::~ScopedRealtimeSection()
+    {
+        armedSection = previousDescription;
+    }
+
+    int getNumViolations()
+    {
+        return numViolations.load();
+    }
+
+    bool canCheckSystemCalls()
+    {
+        return FLANGER_RT_CHECK_INTERPOSE != 0;
+    }
+}
+
+//==============================================================================
+#if FLANGER_RT_CHECK_INTERPOSE
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+
+    void* malloc(size_t size)
+    {
+        checkRealtime("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size)
+    {
+        checkRealtime("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size)
+    {
+        checkRealtime("realloc");
+        return __libc_realloc(pointer, size);
+    }
+
+    void free(void* pointer)
+    {
+        if (pointer != nullptr)
+            checkRealtime("free");
+
+        __libc_free(pointer);
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex)
+    {
+        checkRealtime("pthread_mutex_lock");
+        return next().mutexLock(mutex);
+    }
+
+    int pthread_mutex_trylock(pthread_mutex_t* mutex)
+    {
+        checkRealtime("pthread_mutex_trylock");
+        return next().mutexTryLock(mutex);
+    }
+
+    int pthread_cond_wait(pthread_cond_t* condition, pthread_mutex_t* mutex)
+    {
+        checkRealtime("pthread_cond_wait");
+        return next().condWait(condition, mutex);
+    }
+
+    int pthread_cond_timedwait(pthread_cond_t* condition, pthread_mutex_t* mutex, const struct timespec* timeout)
+    {
+        checkRealtime("pthread_cond_timedwait");
+        return next().condTimedWait(condition, mutex, timeout);
+    }
+
+    ssize_t read(int fd, void* buffer, size_t count)
+    {
+        checkRealtime("read");
+        return next().read(fd, buffer, count);
+    }
+
+    ssize_t write(int fd, const void* buffer, size_t count)
+    {
+        checkRealtime("write");
+        return next().write(fd, buffer, count);
+    }
+
+    int close(int fd)
+    {
+        checkRealtime("close");
+        return next().close(fd);
+    }
+
+    int nanosleep(const struct timespec* duration, struct timespec* remaining)
+    {
+        checkRealtime("nanosleep");
+        return next().nanosleep(duration, remaining);
+    }
+
+    int usleep(useconds_t microseconds)
+    {
+        checkRealtime("usleep");
+        return next().usleep(microseconds);
+    }
+
+    int sched_yield()
+    {
+        checkRealtime("sched_yield");
+        return next().sched_yield();
+    }
+}
+#endif
+
+//==============================================================================
+// operator new/delete are checked on every platform. On Linux they go straight
+// to glibc so a single allocation isn't reported twice via malloc as well.
+namespace
+{
+    void* allocate(size_t size, const char* what)
+    {
+        checkRealtime(what);
+
+       #if FLANGER_RT_CHECK_INTERPOSE
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+
+    void deallocate(void* pointer, const char* what)
+    {
+        if (pointer == nullptr)
+            return;
+
+        checkRealtime(what);
+
+       #if FLANGER_RT_CHECK_INTERPOSE
+        __libc_free(pointer);
+       #else
+        std::free(pointer);
+       #endif
+    }
+}
+
+void* operator new(size_t size)
+{
+    if (auto* pointer = allocate(size, "operator new"))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (auto* pointer = allocate(size, "operator new[]"))
+        return pointer;
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept      { return allocate(size, "operator new"); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept    { return allocate(size, "operator new[]"); }
+void operator delete(void* pointer) noexcept                          { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer) noexcept                        { deallocate(pointer, "operator delete[]"); }
+void operator delete(void* pointer, size_t) noexcept                  { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer, size_t) noexcept                { deallocate(pointer, "operator delete[]"); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept   { deallocate(pointer, "operator delete"); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer, "operator delete[]"); }
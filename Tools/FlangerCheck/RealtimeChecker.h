@@ -0,0 +1,39 @@
+/*
+  ==============================================================================
+
+    Real-time safety checker for the audio thread.
+
+    While a ScopedRealtimeSection is alive on a thread, any heap allocation or
+    deallocation, mutex lock or blocking system call made from that thread is
+    reported with a stack trace and counted as a violation. The hooks replace
+    the global operator new/delete and, on Linux, interpose malloc and the
+    pthread/libc entry points, so they only take effect in the executable that
+    links RealtimeChecker.cpp.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+namespace RealtimeChecker
+{
+    class ScopedRealtimeSection
+    {
+    public:
+        // description is shown in violation reports, so it must outlive the section
+        explicit ScopedRealtimeSection(const char* description);
+        ~ScopedRealtimeSection();
+
+        ScopedRealtimeSection(const ScopedRealtimeSection&) = delete;
+        ScopedRealtimeSection& operator=(const ScopedRealtimeSection&) = delete;
+
+    private:
+        const char* previousDescription;
+    };
+
+    // Total violations reported on any thread so far
+    int getNumViolations();
+
+    // True when malloc, locks and system calls are hooked as well as operator new
+    bool canCheckSystemCalls();
+}
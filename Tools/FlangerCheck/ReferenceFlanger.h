@@ -0,0 +1,285 @@
+/*
+  ==============================================================================
+
+    Frozen scalar reference of the flanger DSP.
+
+    This is the per-sample algorithm from FlangerAudioProcessor::processBlock
+    as it stood before any kernel optimisation, kept deliberately naive so
+    optimised kernels can be checked against it. Don't "improve" it: only
+    change it together with a deliberate change to how the plugin sounds.
+
+    It has had one such change. The read position used to be a single float,
+    rebuilt with fmodf from the write pointer, which near the end of a 2 s
+    buffer only resolves 1/128 of a sample. It is now a whole sample index
+    plus the fraction of a sample towards the next, which moves the taps by
+    up to that much; what is frozen is this form. The kernels split the
+    position the same way, so this reference can't catch a mistake in the
+    split: FlangerCheck checks the modulation stage's read positions against
+    ones worked out in double instead.
+
+    The LFO is read from the same FlangerLfo tables as the processor: the read
+    position is a float, so even a 1e-6 difference in the LFO moves it by whole
+    ulps and would swamp the kernel tolerances. The tables are checked against
+    the directly evaluated waveforms in lfo() instead. The windowed sinc reads
+    the processor's coefficient table for the same reason, and the table is
+    checked against sinc() and kaiser().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "FlangerInterpolators.h"
+#include "FlangerLfo.h"
+
+struct ReferenceParameters
+{
+    float delayMs = 15.0f;
+    float sweepMs = 0.7f;
+    float depth = 1.0f;
+    float feedback = 0.8f;
+    float frequency = 5.0f;
+    int waveform = 0;       // FlangerAudioProcessor::Waves
+    int interpolation = 0;  // FlangerAudioProcessor::Interpol
+    bool stereo = false;
+};
+
+class ReferenceFlanger
+{
+public:
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        delayBufferLength = (int)(2 * sampleRate);
+
+        if (delayBufferLength < 1)
+            delayBufferLength = 1;
+
+        for (auto& channel : delayBuffer)
+            channel.assign((size_t)delayBufferLength, 0.0f);
+
+        delayBufferWrite = 0;
+        allpassState[0] = allpassState[1] = 0.0f;
+        inverseSampleRate = 1.0 / sampleRate;
+        lfoPhase = 0;
+    }
+
+    // Processes numChannels (at most 2) channels of numSamples samples in place
+    void process(float* const* channels, int numChannels, int numSamples, const ReferenceParameters& p)
+    {
+        int dpw = delayBufferWrite;
+        uint32_t channel0EndPhase = lfoPhase;
+
+        // The phase is a 32-bit accumulator where 2^32 is one cycle, as in the processor
+        const double cycles = p.frequency * inverseSampleRate;
+        const uint32_t phaseIncrement = cycles > 0.0
+            ? (uint32_t)(uint64_t)std::llround((cycles - std::floor(cycles)) * 4294967296.0) : 0u;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            float* channelData = channels[channel];
+            float* delayData = delayBuffer[channel < 1 ? channel : 1].data();
+
+            dpw = delayBufferWrite;
+            uint32_t ph = lfoPhase;
+
+            if (p.stereo && channel != 0)
+                ph += 0x40000000u;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const float in = channelData[i];
+                float interpolatedSample = 0.0;
+
+                float currentDelay = p.delayMs + p.sweepMs * FlangerLfo::lookup(FlangerLfo::getTable(p.waveform), ph);
+
+                // The read position, delaySamples behind the write pointer, as a whole
+                // sample index plus the fraction of a sample towards the next one
+                float delaySamples = currentDelay * (float)(sampleRate * 0.001);
+                float wholeSamples = floorf(delaySamples);
+                float part = delaySamples - wholeSamples;
+
+                int readIndex = dpw - (int)wholeSamples - (part > 0.0f ? 1 : 0);
+
+                if (readIndex < 0)
+                    readIndex += delayBufferLength;
+
+                float fraction = part > 0.0f ? 1.0f - part : 0.0f;
+
+                if (p.interpolation == 0)
+                {
+                    int previousSample = readIndex;
+                    int nextSample = (previousSample + 1) % delayBufferLength;
+                    interpolatedSample = fraction * delayData[nextSample]
+                        + (1.0f - fraction) * delayData[previousSample];
+                }
+                else if (p.interpolation == 1)
+                {
+                    interpolatedSample = lagrange(delayData, readIndex, 1, 3, fraction);
+                }
+                else if (p.interpolation == 2)
+                {
+                    int sample1 = readIndex;
+                    int sample2 = (sample1 + 1) % delayBufferLength;
+                    int sample3 = (sample2 + 1) % delayBufferLength;
+                    int sample0 = (sample1 - 1 + delayBufferLength) % delayBufferLength;
+
+                    float frsq = fraction * fraction;
+
+                    float a0 = -0.5f * delayData[sample0] + 1.5f * delayData[sample1]
+                        - 1.5f * delayData[sample2] + 0.5f * delayData[sample3];
+                    float a1 = delayData[sample0] - 2.5f * delayData[sample1]
+                        + 2.0f * delayData[sample2] - 0.5f * delayData[sample3];
+                    float a2 = -0.5f * delayData[sample0] + 0.5f * delayData[sample2];
+                    float a3 = delayData[sample1];
+
+                    interpolatedSample = a0 * fraction * frsq + a1 * frsq + a2 * fraction + a3;
+                }
+                else if (p.interpolation == 3)
+                {
+                    interpolatedSample = lagrange(delayData, readIndex, 1, 4, fraction);
+                }
+                else if (p.interpolation == 4)
+                {
+                    interpolatedSample = lagrange(delayData, readIndex, 2, 6, fraction);
+                }
+                else if (p.interpolation == 5)
+                {
+                    const int phase = (int)(fraction * (float)FlangerKernel::kPhases + 0.5f);
+                    const float* coefficients = FlangerKernel::SincInterpolator::getCoefficients(phase);
+
+                    for (int tap = 0; tap < 8; ++tap)
+                        interpolatedSample += coefficients[tap] * delayData[(readIndex - 3 + tap + delayBufferLength) % delayBufferLength];
+                }
+                else if (p.interpolation == 6)
+                {
+                    // First-order allpass with a delay of 0.5 to 1.5 samples from the newer of two taps
+                    const int phase = (int)(fraction * (float)FlangerKernel::kPhases + 0.5f);
+                    const float roundedFraction = (float)phase / (float)FlangerKernel::kPhases;
+                    const int older = phase < FlangerKernel::kPhases / 2 ? readIndex : (readIndex + 1) % delayBufferLength;
+                    const int newer = (older + 1) % delayBufferLength;
+                    const float allpassDelay = phase < FlangerKernel::kPhases / 2 ? 1.0f - roundedFraction : 2.0f - roundedFraction;
+                    const float eta = (1.0f - allpassDelay) / (1.0f + allpassDelay);
+
+                    float& previous = allpassState[channel < 1 ? channel : 1];
+                    interpolatedSample = eta * delayData[newer] + delayData[older] - eta * previous;
+                    previous = interpolatedSample;
+                }
+
+                delayData[dpw] = in + (interpolatedSample * p.feedback);
+
+                if (++dpw >= delayBufferLength)
+                    dpw = 0;
+
+                channelData[i] = in + p.depth * interpolatedSample;
+
+                ph += phaseIncrement;
+            }
+
+            if (channel == 0)
+                channel0EndPhase = ph;
+        }
+
+        delayBufferWrite = dpw;
+        lfoPhase = channel0EndPhase;
+    }
+
+    // The Lagrange polynomial through numTaps samples from tapsBefore before readIndex,
+    // evaluated fraction of the way from readIndex to the next sample
+    float lagrange(const float* delayData, int readIndex, int tapsBefore, int numTaps, float fraction) const
+    {
+        float sum = 0.0f;
+
+        for (int j = 0; j < numTaps; ++j)
+        {
+            float basis = 1.0f;
+
+            for (int m = 0; m < numTaps; ++m)
+                if (m != j)
+                    basis *= (fraction - (float)(m - tapsBefore)) / (float)(j - m);
+
+            sum += basis * delayData[(readIndex - tapsBefore + j + delayBufferLength) % delayBufferLength];
+        }
+
+        return sum;
+    }
+
+    // The sinc interpolator's taps: sin(pi t) / (pi t) at t samples from the read point,
+    // under a Kaiser window halfWidth samples either side of it
+    static double sinc(double t)
+    {
+        const double pi = 3.14159265358979323846;
+        return t == 0.0 ? 1.0 : std::sin(pi * t) / (pi * t);
+    }
+
+    static double kaiser(double t, double halfWidth, double beta)
+    {
+        auto i0 = [](double x)
+        {
+            double term = 1.0, sum = 1.0;
+
+            for (int k = 1; k < 50; ++k)
+            {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+
+            return sum;
+        };
+
+        const double u = t / halfWidth;
+        return u * u < 1.0 ? i0(beta * std::sqrt(1.0 - u * u)) / i0(beta) : i0(0.0) / i0(beta);
+    }
+
+    // The waveforms evaluated directly rather than from a table, for phase in
+    // [0, 1). Square and saw edges are raised-cosine ramps 1/32 of a cycle wide.
+    static double lfo(double phase, int waveform)
+    {
+        const double pi = 3.14159265358979323846;
+        const double edge = 1.0 / 32.0;
+        auto rise = [pi](double t) { return 0.5 - 0.5 * std::cos(pi * t); };
+
+        switch (waveform)
+        {
+        case 1:
+            if (phase < 0.25)
+                return 0.5 + 2.0 * phase;
+            else if (phase < 0.75)
+                return 1.0 - 2.0 * (phase - 0.25);
+            else
+                return 2.0 * (phase - 0.75);
+        case 2:
+            if (phase < 0.5 * edge)
+                return rise(0.5 + phase / edge);
+            else if (phase < 0.5 - 0.5 * edge)
+                return 1.0;
+            else if (phase < 0.5 + 0.5 * edge)
+                return 1.0 - rise((phase - 0.5 + 0.5 * edge) / edge);
+            else if (phase < 1.0 - 0.5 * edge)
+                return 0.0;
+            else
+                return rise((phase - 1.0 + 0.5 * edge) / edge);
+        case 3:
+        {
+            const double u = std::fmod(phase + 0.5 - 0.5 * edge, 1.0);
+            return u < 1.0 - edge ? u / (1.0 - edge) : 1.0 - rise((u - 1.0 + edge) / edge);
+        }
+        case 0:
+        default:
+            return 0.5 + 0.5 * std::sin(2.0 * pi * phase);
+        }
+    }
+
+private:
+    double sampleRate = 44100.0;
+    double inverseSampleRate = 1.0 / 44100.0;
+    std::vector<float> delayBuffer[2];
+    int delayBufferLength = 1;
+    int delayBufferWrite = 0;
+    float allpassState[2] = {};
+    uint32_t lfoPhase = 0;
+};
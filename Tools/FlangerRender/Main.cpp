@@ -0,0 +1,305 @@
+/*
+  ==============================================================================
+
+    Headless offline renderer for FlangerAudioProcessor.
+
+    Streams an audio file through processBlock in fixed size blocks, without an
+    editor, host or audio device, and reports how many times faster than
+    realtime the DSP ran.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "FlangerTrace.h"
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // "sweep width", "SweepWidth" and "sweep_width" all name the same parameter
+    juce::String normaliseParameterName(const juce::String& name)
+    {
+        return name.toLowerCase().removeCharacters(" _-");
+    }
+
+    void setParameterByName(FlangerAudioProcessor& processor, const juce::String& name, float value)
+    {
+        for (int i = 0; i < processor.getNumParameters(); ++i)
+        {
+            if (normaliseParameterName(processor.getParameterName(i)) == normaliseParameterName(name))
+            {
+                processor.setParameter(i, value);
+                return;
+            }
+        }
+
+        juce::ConsoleApplication::fail("Unknown parameter: " + name);
+    }
+
+    // The JSON file is a flat object of parameter name -> value, e.g.
+    // { "delay": 10, "sweep width": 0.5, "waveform": 1, "interpolation": 2 }
+    void applyParameterFile(FlangerAudioProcessor& processor, const juce::File& file)
+    {
+        auto json = juce::JSON::parse(file);
+        auto* object = json.getDynamicObject();
+
+        if (object == nullptr)
+            juce::ConsoleApplication::fail("Expected a JSON object of parameter values in " + file.getFullPathName());
+        else
+            for (auto& property : object->getProperties())
+                setParameterByName(processor, property.name.toString(), (float)property.value);
+    }
+
+    // Every "--set name=value" pair on the command line, applied after the JSON file
+    void applyParameterOptions(FlangerAudioProcessor& processor, const juce::ArgumentList& args)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            if (args.arguments[i].text != "--set")
+                continue;
+
+            const auto assignment = i + 1 < args.size() ? args.arguments[i + 1].text : juce::String();
+
+            if (!assignment.containsChar('='))
+                juce::ConsoleApplication::fail("--set expects name=value, e.g. --set delay=10");
+
+            setParameterByName(processor,
+                assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                assignment.fromFirstOccurrenceOf("=", false, false).getFloatValue());
+        }
+    }
+
+    std::unique_ptr<juce::AudioFormatWriter> createWriter(juce::AudioFormatManager& formatManager,
+                                                          const juce::File& file,
+                                                          const juce::AudioFormatReader& reader)
+    {
+        auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+        if (format == nullptr)
+        {
+            juce::ConsoleApplication::fail("Can't write '" + file.getFileExtension() + "' files, use .wav or .aiff");
+            return {};
+        }
+
+        file.deleteFile();
+        auto stream = std::make_unique<juce::FileOutputStream>(file);
+
+        if (stream->failedToOpen())
+        {
+            juce::ConsoleApplication::fail("Couldn't open " + file.getFullPathName() + " for writing");
+            return {};
+        }
+
+        const int bitsPerSample = format->getPossibleBitDepths().contains((int)reader.bitsPerSample)
+                                    ? (int)reader.bitsPerSample : 24;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), reader.sampleRate,
+                                                                                reader.numChannels, bitsPerSample,
+                                                                                {}, 0));
+        if (writer == nullptr)
+        {
+            juce::ConsoleApplication::fail("Couldn't create a writer for " + file.getFullPathName());
+            return {};
+        }
+
+        stream.release(); // the writer owns the stream now
+        return writer;
+    }
+
+    void printPerfCounters(const PerfCounters& counters, const PerfCounters::Totals& totals)
+    {
+        if (!counters.isAvailable())
+        {
+            std::cout << "  counters:     unavailable (" << counters.getUnavailableReason() << ")" << std::endl;
+            return;
+        }
+
+        std::cout << "  counters per sample frame:" << std::endl;
+
+        for (int i = 0; i < PerfCounters::kNumCounters; ++i)
+        {
+            const auto counter = (PerfCounters::Counter)i;
+            std::cout << "    " << juce::String(PerfCounters::getName(counter)).paddedRight(' ', 14)
+                      << (counters.isAvailable(counter) ? juce::String(totals.getPerSample(counter), 3) : juce::String("n/a"))
+                      << std::endl;
+        }
+
+        if (counters.isAvailable(PerfCounters::kCycles) && counters.isAvailable(PerfCounters::kInstructions)
+            && totals.getPerSample(PerfCounters::kCycles) > 0.0)
+            std::cout << "    " << juce::String("ipc").paddedRight(' ', 14)
+                      << juce::String(totals.getPerSample(PerfCounters::kInstructions) / totals.getPerSample(PerfCounters::kCycles), 3)
+                      << std::endl;
+    }
+
+    void render(const juce::ArgumentList& args)
+    {
+        const auto inputFile = args.getExistingFileForOption("--input|-i");
+        const int blockSize = args.containsOption("--block-size|-b")
+                                ? args.getValueForOption("--block-size|-b").getIntValue() : 512;
+
+        if (blockSize < 1)
+            juce::ConsoleApplication::fail("--block-size must be at least 1");
+
+        if (args.containsOption("--trace") && !FlangerTrace::isEnabled())
+            juce::ConsoleApplication::fail("--trace needs a build configured with -DFLANGER_ENABLE_TRACE=ON");
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+
+        if (reader == nullptr)
+        {
+            juce::ConsoleApplication::fail("Couldn't read " + inputFile.getFullPathName());
+            return;
+        }
+
+        const int numChannels = (int)reader->numChannels;
+        const double sampleRate = reader->sampleRate;
+
+        if (numChannels < 1 || numChannels > 2)
+            juce::ConsoleApplication::fail("Only mono and stereo files are supported");
+
+        // Double precision is chosen before prepareToPlay, as a host would
+        const bool doublePrecision = args.containsOption("--double");
+
+        FlangerAudioProcessor processor;
+        processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+        processor.setProcessingPrecision(doublePrecision ? juce::AudioProcessor::doublePrecision
+                                                         : juce::AudioProcessor::singlePrecision);
+
+        // Set before prepareToPlay, so the render starts at these values instead of gliding to them
+        if (args.containsOption("--params|-p"))
+            applyParameterFile(processor, args.getExistingFileForOption("--params|-p"));
+
+        applyParameterOptions(processor, args);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+
+        if (args.containsOption("--output|-o"))
+            writer = createWriter(formatManager, args.getFileForOption("--output|-o"), *reader);
+
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::AudioBuffer<double> doubleBuffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+        juce::int64 processTicks = 0;
+
+        // Opened here because the counters only follow the thread that creates them
+        std::unique_ptr<PerfCounters> perfCounters;
+        PerfCounters::Totals perfTotals;
+
+        if (args.containsOption("--perf"))
+            perfCounters = std::make_unique<PerfCounters>();
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+        {
+            const int numSamples = (int)juce::jmin((juce::int64)blockSize, reader->lengthInSamples - position);
+
+            // Refers to the start of buffer, so the final short block doesn't need a resize
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+            reader->read(&block, 0, numSamples, position, true, true);
+
+            auto process = [&](auto& audio)
+            {
+                const auto countsBefore = perfCounters != nullptr ? perfCounters->read() : PerfCounters::Values {};
+                const auto blockStartTicks = juce::Time::getHighResolutionTicks();
+                processor.processBlock(audio, midi);
+                processTicks += juce::Time::getHighResolutionTicks() - blockStartTicks;
+
+                if (perfCounters != nullptr)
+                    perfTotals.add(countsBefore, perfCounters->read(), numSamples);
+            };
+
+            if (doublePrecision)
+            {
+                // The files are read and written as float, so convert either side of
+                // processBlock, outside the timing
+                juce::AudioBuffer<double> doubleBlock(doubleBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    std::copy(block.getReadPointer(ch), block.getReadPointer(ch) + numSamples, doubleBlock.getWritePointer(ch));
+
+                process(doubleBlock);
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    std::copy(doubleBlock.getReadPointer(ch), doubleBlock.getReadPointer(ch) + numSamples, block.getWritePointer(ch));
+            }
+            else
+            {
+                process(block);
+            }
+
+            if (writer != nullptr)
+                writer->writeFromAudioSampleBuffer(block, 0, numSamples);
+        }
+
+        const auto totalTicks = juce::Time::getHighResolutionTicks() - startTicks;
+        const auto load = processor.getLoadStatistics();
+        processor.releaseResources();
+        writer.reset();
+
+        if (args.containsOption("--trace"))
+        {
+            const auto traceFile = args.getFileForOption("--trace");
+
+            if (!FlangerTrace::writeChromeTrace(traceFile.getFullPathName().toStdString()))
+                juce::ConsoleApplication::fail("Couldn't write " + traceFile.getFullPathName());
+        }
+
+        const double audioSeconds = (double)reader->lengthInSamples / sampleRate;
+        const double processSeconds = juce::Time::highResolutionTicksToSeconds(processTicks);
+        const double totalSeconds = juce::Time::highResolutionTicksToSeconds(totalTicks);
+
+        auto realtimeMultiple = [audioSeconds](double seconds)
+        {
+            return seconds > 0.0 ? juce::String(audioSeconds / seconds, 1) + "x realtime" : juce::String("n/a");
+        };
+
+        std::cout << "Rendered " << juce::String(audioSeconds, 3) << " s of audio ("
+                  << numChannels << " ch, " << sampleRate << " Hz) in blocks of " << blockSize
+                  << (doublePrecision ? " in double precision" : "") << std::endl
+                  << "  processBlock: " << juce::String(processSeconds, 6) << " s ("
+                  << realtimeMultiple(processSeconds) << ")" << std::endl
+                  << "  total:        " << juce::String(totalSeconds, 6) << " s ("
+                  << realtimeMultiple(totalSeconds) << ", including file I/O)" << std::endl
+                  << "  per block:    p99 " << juce::String(load.p99DurationMs, 4) << " ms, max "
+                  << juce::String(load.maxDurationMs, 4) << " ms, peak load " << juce::String(load.maxLoad * 100.0, 1)
+                  << "%, " << (juce::int64)load.numOverruns << " of " << (juce::int64)load.numBlocks
+                  << " blocks over budget" << std::endl;
+
+        if (perfCounters != nullptr)
+            printPerfCounters(*perfCounters, perfTotals);
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::ConsoleApplication app;
+
+    app.addHelpCommand("--help|-h", "Usage:", true);
+
+    app.addDefaultCommand({ "--render",
+                            "--input=<file> [--output=<file>] [--block-size=<n>] [--params=<file.json>] [--set name=value ...] [--double] [--trace=<file.json>] [--perf]",
+                            "Streams a WAV/AIFF file through FlangerAudioProcessor",
+                            "Reads --input in blocks of --block-size samples (default 512), runs each block through "
+                            "processBlock and optionally writes the result to --output. Parameters are taken from a "
+                            "JSON object of name/value pairs given with --params, then from any number of "
+                            "--set name=value pairs, using the names reported by getParameterName(). --double runs "
+                            "processBlock in double precision, as a 64-bit host would. In builds with "
+                            "FLANGER_ENABLE_TRACE, --trace writes the recorded trace markers as Chrome trace JSON. On Linux, "
+                            "--perf reads the hardware counters around every processBlock call and reports cycles, "
+                            "instructions, L1d/LLC misses and branch misses per sample frame.",
+                            render });
+
+    return app.findAndRunCommand(argc, argv);
+}